@@ -0,0 +1,65 @@
+/*! @file
+  @brief
+  Benchmark for the bitmap search path of est_malloc().
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  Every request misses its own and the next free_blocks index, so that
+  est_malloc() always searches the bitmap for a larger block.
+  Build with and without ESTALLOC_FLAT_BITMAP to compare.
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../estalloc.h"
+
+#define POOL_SIZE (1024 * 1024 - 1)   // 1MB pool
+#define NUM_SIZES 64
+#define ITERATIONS 2000000
+
+static double
+elapsed_ns(struct timespec *t0, struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+int
+main()
+{
+  static unsigned int sizes[NUM_SIZES];
+  void *pool_memory = malloc(POOL_SIZE);
+  ESTALLOC *est = est_init(pool_memory, POOL_SIZE);
+  struct timespec t0, t1;
+
+  srand(1);
+  for (int i = 0; i < NUM_SIZES; i++) {
+    sizes[i] = (rand() % 2048) + 1;
+  }
+
+  // malloc and free immediately. the free block merges back into
+  // the single large block, so only the top bins are non-empty.
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int i = 0; i < ITERATIONS; i++) {
+    void *ptr = est_malloc(est, sizes[i % NUM_SIZES]);
+    est_free(est, ptr);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  printf("%-12s malloc+free (search path): %6.2f ns/op\n",
+#if defined(ESTALLOC_FLAT_BITMAP)
+         "flat",
+#else
+         "two-level",
+#endif
+         elapsed_ns(&t0, &t1) / ITERATIONS);
+
+  est_cleanup(est);
+  free(pool_memory);
+  return 0;
+}
@@ -0,0 +1,224 @@
+/*! @file
+  @brief
+  Long-running fragmentation simulation. Outputs a CSV time series.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ bench/bench_frag [-p pool_size] [-n ops] [-k interval] [-P permalloc_interval]
+                       [-L leak_ppm] [-s seed] [-o out.csv] [-H]
+
+  WORKLOAD
+   One allocation per operation. Its lifetime (in operations) is drawn
+   from a mixture of exponential distributions:
+
+    80%   temporaries    mean 20 ops,      8..128 bytes
+    18%   medium         mean 1000 ops,    16..512 bytes
+     2%   long-lived     mean 10000 ops,   16..256 bytes
+
+   and leak_ppm per million allocations are never freed. Every
+   permalloc_interval operations, est_permalloc() takes 16..64 bytes.
+   With -H, temporaries are allocated by est_malloc_hint() with
+   EST_HINT_SHORT_LIVED, and long-lived ones with EST_HINT_LONG_LIVED.
+
+   Every interval operations, a row is written:
+    ops, live objects, used, free, largest free block, free blocks,
+    stat.frag and the number of failed allocations so far.
+   The first failure is reported to stderr as the time to failure.
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "../estalloc.h"
+
+typedef struct OBJECT {
+  uint64_t death;                 //!< operation number to free.
+  void *ptr;
+} OBJECT;
+
+static uint32_t seed = 1;
+
+// live objects. binary min-heap on death.
+static OBJECT *heap;
+static unsigned int heap_count, heap_capacity;
+
+
+static uint32_t
+next_random(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// uniform in (0, 1)
+static double
+next_uniform(void)
+{
+  return (next_random() + 1.0) / (double)((1 << 24) + 1);
+}
+
+static uint64_t
+next_lifetime(double mean)
+{
+  return (uint64_t)(-mean * log(next_uniform())) + 1;
+}
+
+static unsigned int
+next_range(unsigned int min, unsigned int max)
+{
+  return min + next_random() % (max - min + 1);
+}
+
+
+static void
+heap_push(OBJECT obj)
+{
+  if (heap_count == heap_capacity) {
+    heap_capacity = heap_capacity ? heap_capacity * 2 : 1024;
+    heap = realloc(heap, sizeof(OBJECT) * heap_capacity);
+  }
+
+  unsigned int i = heap_count++;
+  while (i > 0 && heap[(i - 1) / 2].death > obj.death) {
+    heap[i] = heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap[i] = obj;
+}
+
+static OBJECT
+heap_pop(void)
+{
+  OBJECT top = heap[0];
+  OBJECT last = heap[--heap_count];
+  unsigned int i = 0;
+
+  while (1) {
+    unsigned int c = i * 2 + 1;
+    if (c >= heap_count) break;
+    if (c + 1 < heap_count && heap[c + 1].death < heap[c].death) c++;
+    if (last.death <= heap[c].death) break;
+    heap[i] = heap[c];
+    i = c;
+  }
+  if (heap_count > 0) heap[i] = last;
+  return top;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  unsigned int pool_size = 1024 * 256;
+  uint64_t num_ops = 10000000;
+  uint64_t interval = 10000;
+  uint64_t permalloc_interval = 200000;
+  unsigned int leak_ppm = 20;
+  const char *out = NULL;
+  int use_hint = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:n:k:P:L:s:o:H")) != -1) {
+    switch (opt) {
+    case 'p': pool_size = strtoul(optarg, NULL, 0); break;
+    case 'n': num_ops = strtoull(optarg, NULL, 0); break;
+    case 'k': interval = strtoull(optarg, NULL, 0); break;
+    case 'P': permalloc_interval = strtoull(optarg, NULL, 0); break;
+    case 'L': leak_ppm = strtoul(optarg, NULL, 0); break;
+    case 's': seed = strtoul(optarg, NULL, 0); break;
+    case 'o': out = optarg; break;
+    case 'H': use_hint = 1; break;
+    default:
+      fprintf(stderr, "usage: %s [-p pool_size] [-n ops] [-k interval] [-P permalloc_interval]"
+              " [-L leak_ppm] [-s seed] [-o out.csv] [-H]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (interval == 0) interval = 1;
+
+  FILE *fp = out ? fopen(out, "w") : stdout;
+  if (fp == NULL) {
+    fprintf(stderr, "can't open %s\n", out);
+    return 1;
+  }
+
+  void *pool_memory = malloc(pool_size);
+  ESTALLOC *est = est_init(pool_memory, pool_size);
+  uint64_t failures = 0, first_failure = 0;
+
+  fprintf(fp, "ops,live,used,free,largest_free,free_blocks,frag,failures\n");
+
+  for (uint64_t now = 1; now <= num_ops; now++) {
+    // release expired objects.
+    while (heap_count > 0 && heap[0].death <= now) {
+      est_free(est, heap_pop().ptr);
+    }
+
+    if (permalloc_interval && now % permalloc_interval == 0) {
+      if (est_permalloc(est, next_range(16, 64)) == NULL) {
+        if (failures++ == 0) first_failure = now;
+      }
+    }
+
+    // allocate one object.
+    uint32_t kind = next_random() % 100;
+    OBJECT obj;
+    unsigned int size;
+    int hint;
+    if (kind < 80) {
+      size = next_range(8, 128);
+      obj.death = now + next_lifetime(20);
+      hint = EST_HINT_SHORT_LIVED;
+    } else if (kind < 98) {
+      size = next_range(16, 512);
+      obj.death = now + next_lifetime(1000);
+      hint = 0;
+    } else {
+      size = next_range(16, 256);
+      obj.death = now + next_lifetime(10000);
+      hint = EST_HINT_LONG_LIVED;
+    }
+    if (next_random() % 1000000 < leak_ppm) obj.death = UINT64_MAX;
+
+    obj.ptr = use_hint ? est_malloc_hint(est, size, hint) : est_malloc(est, size);
+    if (obj.ptr) {
+      heap_push(obj);
+    } else if (failures++ == 0) {
+      first_failure = now;
+    }
+
+    if (now % interval == 0) {
+      ESTALLOC_FREE_STAT fstat;
+      est_take_statistics(est);
+      est_take_free_statistics(est, &fstat);
+      fprintf(fp, "%llu,%u,%u,%u,%u,%u,%d,%llu\n", (unsigned long long)now, heap_count,
+              (unsigned int)est->stat.used, (unsigned int)est->stat.free,
+              (unsigned int)fstat.largest, (unsigned int)fstat.count,
+              (int)est->stat.frag, (unsigned long long)failures);
+    }
+  }
+
+  if (failures) {
+    fprintf(stderr, "pool %u bytes: first failure at op %llu, %llu failures in %llu ops\n",
+            pool_size, (unsigned long long)first_failure,
+            (unsigned long long)failures, (unsigned long long)num_ops);
+  } else {
+    fprintf(stderr, "pool %u bytes: no failure in %llu ops\n",
+            pool_size, (unsigned long long)num_ops);
+  }
+
+  if (fp != stdout) fclose(fp);
+  free(pool_memory);
+  free(heap);
+  return 0;
+}
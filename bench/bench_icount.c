@@ -0,0 +1,313 @@
+/*! @file
+  @brief
+  Deterministic instruction count benchmark for regression gating.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ bench/bench_icount_8_24_64bit [-n] [-c file] [-t percent] [-b baseline] [-u] config_name
+
+    -n  do not use hardware counters (e.g. under valgrind --tool=cachegrind)
+    -c  read Ir of estalloc.c from the cachegrind output file
+    -t  regression threshold in percent (default: 5)
+    -b  baseline file (default: bench/icount_baseline.txt)
+    -u  print baseline lines instead of comparing
+
+  Workloads use a fixed seed, so instruction and branch counts are
+  reproducible. They are counted by perf_event_open(2) and reported per
+  call. Cache misses are reported but not gated, because they depend on
+  the machine.
+
+  Without hardware counters (e.g. on CI runners), run the workload under
+  cachegrind first, and then with -c. Instructions executed in estalloc.c
+  (Ir) are divided by the number of all calls to the allocator, and
+  compared with the "all Ir" baseline. (see "make bench_cachegrind")
+  Configurations without a baseline line are reported only.
+
+  Exit status is 1 if instructions or branches per call exceed the
+  baseline by the threshold.
+  </pre>
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../estalloc.h"
+
+#if defined(ESTALLOC_ADDRESS_16BIT)
+# define POOL_SIZE (1024 * 60)         // 60KB pool
+# define NUM_LIVE 256
+#else
+# define POOL_SIZE (1024 * 1024)       // 1MB pool
+# define NUM_LIVE 4096
+#endif
+#define NUM_MIXED (NUM_LIVE * 4)
+#define NUM_COUNTERS 3
+
+static const char *counter_names[NUM_COUNTERS] = {
+  "instructions", "branches", "cache_misses",
+};
+static const uint64_t counter_configs[NUM_COUNTERS] = {
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+};
+
+static int counter_fd[NUM_COUNTERS] = { -1, -1, -1 };
+static uint32_t seed;
+static unsigned int total_calls;   // all calls to the allocator
+
+// Fixed-seed LCG. (rand() differs between libc)
+static uint32_t
+next_random(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// Request size: mostly small, sometimes large
+static unsigned int
+next_size(void)
+{
+  uint32_t r = next_random();
+  if ((r & 7) == 0) return (r >> 3) % 256 + 8;
+  return (r >> 3) % 64 + 8;
+}
+
+static int
+open_counters(void)
+{
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = counter_configs[i];
+    attr.disabled = (i == 0);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    counter_fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : counter_fd[0], 0);
+    if (counter_fd[i] < 0) return -1;
+  }
+  return 0;
+}
+
+static void
+start_counters(void)
+{
+  if (counter_fd[0] < 0) return;
+  ioctl(counter_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(counter_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void
+stop_counters(uint64_t *values)
+{
+  uint64_t buf[1 + NUM_COUNTERS] = {0};
+  if (counter_fd[0] >= 0) {
+    ioctl(counter_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(counter_fd[0], buf, sizeof(buf)) < 0) buf[0] = 0;
+  }
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    values[i] = (buf[0] == NUM_COUNTERS) ? buf[1 + i] : 0;
+  }
+}
+
+// Sum Ir of estalloc.c in the cachegrind output. returns 0 if not found.
+static double
+read_cachegrind_ir(const char *file)
+{
+  FILE *fp = fopen(file, "r");
+  char line[1024], is_estalloc[256];
+  int in_estalloc = 0;
+  double total = 0;
+
+  if (fp == NULL) return 0;
+  memset(is_estalloc, 0, sizeof(is_estalloc));
+  while (fgets(line, sizeof(line), fp)) {
+    if (strncmp(line, "fl=", 3) == 0) {
+      // "fl=path", or compressed "fl=(id) path" and "fl=(id)".
+      const char *name = line + 3;
+      int id = -1;
+      if (*name == '(') {
+        id = atoi(name + 1);
+        name = strchr(name, ')');
+        name = name ? name + 1 : "";
+        while (*name == ' ') name++;
+      }
+      if (*name != '\0' && *name != '\n') {
+        in_estalloc = (strstr(name, "estalloc.c\n") != NULL);
+        if (id >= 0 && id < 256) is_estalloc[id] = in_estalloc;
+      } else if (id >= 0 && id < 256) {
+        in_estalloc = is_estalloc[id];
+      }
+      continue;
+    }
+    if (!in_estalloc || line[0] < '0' || line[0] > '9') continue;
+
+    // "line Ir ..."
+    char *p = strchr(line, ' ');
+    if (p) total += strtod(p + 1, NULL);
+  }
+  fclose(fp);
+  return total;
+}
+
+// Find the baseline value. returns 0 if not found.
+static double
+find_baseline(const char *file, const char *config, const char *phase, const char *name)
+{
+  FILE *fp = fopen(file, "r");
+  char line[256], c[64], p[64], n[64];
+  double value, found = 0;
+
+  if (fp == NULL) return 0;
+  while (fgets(line, sizeof(line), fp)) {
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%63s %63s %63s %lf", c, p, n, &value) != 4) continue;
+    if (strcmp(c, config) == 0 && strcmp(p, phase) == 0 && strcmp(n, name) == 0) {
+      found = value;
+    }
+  }
+  fclose(fp);
+  return found;
+}
+
+int
+main(int argc, char *argv[])
+{
+  const char *baseline = "bench/icount_baseline.txt";
+  double threshold = 5.0;
+  const char *cachegrind = NULL;
+  int use_counters = 1, update = 0, regressions = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "nc:t:b:u")) != -1) {
+    switch (opt) {
+    case 'n': use_counters = 0; break;
+    case 'c': cachegrind = optarg; use_counters = 0; break;
+    case 't': threshold = atof(optarg); break;
+    case 'b': baseline = optarg; break;
+    case 'u': update = 1; break;
+    default:
+      fprintf(stderr, "usage: %s [-n] [-c file] [-t percent] [-b baseline] [-u] config_name\n", argv[0]);
+      return 2;
+    }
+  }
+  const char *config = (optind < argc) ? argv[optind] : "unknown";
+
+  if (use_counters && open_counters() != 0) {
+    fprintf(stderr, "%s: hardware counters are not available. skipped.\n", config);
+    use_counters = 0;
+  }
+
+  static uint64_t pool_memory[POOL_SIZE / sizeof(uint64_t)];
+  static void *ptrs[NUM_LIVE];
+  ESTALLOC *est = est_init(pool_memory, POOL_SIZE);
+  uint64_t values[3][NUM_COUNTERS];
+  const char *phases[3] = { "malloc", "free", "mixed" };
+  unsigned int calls[3] = { NUM_LIVE, NUM_LIVE, 0 };
+
+  seed = 1;
+  total_calls = 1;    // est_init()
+
+  // phase 1: fill the pool.
+  start_counters();
+  for (int i = 0; i < NUM_LIVE; i++) {
+    ptrs[i] = est_malloc(est, next_size());
+  }
+  stop_counters(values[0]);
+  total_calls += NUM_LIVE;
+
+  // phase 2: free in shuffled order.
+  static unsigned int order[NUM_LIVE];
+  for (int i = 0; i < NUM_LIVE; i++) order[i] = i;
+  for (int i = NUM_LIVE - 1; i > 0; i--) {
+    unsigned int j = next_random() % (i + 1);
+    unsigned int t = order[i]; order[i] = order[j]; order[j] = t;
+  }
+  start_counters();
+  for (int i = 0; i < NUM_LIVE; i++) {
+    est_free(est, ptrs[order[i]]);
+  }
+  stop_counters(values[1]);
+  total_calls += NUM_LIVE;
+
+  // phase 3: steady state. a half of slots are live.
+  for (int i = 0; i < NUM_LIVE; i++) {
+    ptrs[i] = (i & 1) ? est_malloc(est, next_size()) : NULL;
+  }
+  total_calls += NUM_LIVE / 2;
+  start_counters();
+  for (int i = 0; i < NUM_MIXED / 2; i++) {
+    unsigned int slot = next_random() % NUM_LIVE;
+    if (ptrs[slot]) {
+      est_free(est, ptrs[slot]);
+      ptrs[slot] = NULL;
+      calls[2]++;
+    }
+    slot = next_random() % NUM_LIVE;
+    if (ptrs[slot] == NULL) {
+      ptrs[slot] = est_malloc(est, next_size());
+      calls[2]++;
+    }
+  }
+  stop_counters(values[2]);
+  total_calls += calls[2];
+
+  if (cachegrind) {
+    double ir = read_cachegrind_ir(cachegrind);
+    if (ir == 0) {
+      fprintf(stderr, "%s: no Ir of estalloc.c in %s\n", config, cachegrind);
+      return 1;
+    }
+    double per_call = ir / total_calls;
+    if (update) {
+      printf("%s all Ir %.2f\n", config, per_call);
+      return 0;
+    }
+    double base = find_baseline(baseline, config, "all", "Ir");
+    if (base == 0) {
+      printf("%-16s %-7s %-13s %10.2f /call  (no baseline)\n", config, "all", "Ir", per_call);
+      return 0;
+    }
+    int regression = per_call > base * (1.0 + threshold / 100.0);
+    printf("%-16s %-7s %-13s %10.2f /call  baseline %10.2f (%+6.2f%%)%s\n",
+           config, "all", "Ir", per_call, base, (per_call / base - 1.0) * 100.0,
+           regression ? "  REGRESSION" : "");
+    return regression ? 1 : 0;
+  }
+
+  if (!use_counters) return 0;
+
+  for (int p = 0; p < 3; p++) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+      double per_call = (double)values[p][i] / calls[p];
+      if (update) {
+        printf("%s %s %s %.2f\n", config, phases[p], counter_names[i], per_call);
+        continue;
+      }
+      double base = find_baseline(baseline, config, phases[p], counter_names[i]);
+      int gated = (i != 2);   // cache misses are not gated.
+      int regression = gated && base > 0 && per_call > base * (1.0 + threshold / 100.0);
+      printf("%-16s %-7s %-13s %10.2f /call", config, phases[p], counter_names[i], per_call);
+      if (base > 0) printf("  baseline %10.2f (%+6.2f%%)", base, (per_call / base - 1.0) * 100.0);
+      printf("%s\n", regression ? "  REGRESSION" : "");
+      regressions += regression;
+    }
+  }
+
+  return regressions ? 1 : 0;
+}
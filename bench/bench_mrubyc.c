@@ -0,0 +1,320 @@
+/*! @file
+  @brief
+  Synthetic mruby/c allocation profile benchmark.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ bench/bench_mrubyc [-p pool_size] [-b bursts] [-s seed] [-u]
+
+    -u  then run uniform random sizes and free order, with the same
+        number of calls, for comparison.
+
+  WORKLOAD (sizes are those of mruby/c on a 64-bit host)
+   VM boot     est_permalloc() for symbol and method tables, and
+               long-lived class objects.
+   burst       a bytecode run creates RObject, RString, RArray and RHash.
+               Strings grow by realloc() (append), arrays and hash tables
+               double their data area by realloc() (push, store).
+   GC sweep    after each burst, unreachable objects are freed in address
+               order, as a sweep over the heap does. A few objects survive
+               several sweeps (globals, instance variables).
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../estalloc.h"
+
+#define MRBC_VALUE_SIZE   16        // sizeof(mrbc_value)
+#define MRBC_HEADER_SIZE  24        // common header of RObject, RString ...
+#define MAX_OBJECTS       4096
+#define BURST_OBJECTS     48
+
+enum { T_OBJECT, T_STRING, T_ARRAY, T_HASH, NUM_TYPES };
+static const char *type_names[NUM_TYPES] = { "RObject", "RString", "RArray", "RHash" };
+
+typedef struct OBJECT {
+  void *header;
+  void *data;                       //!< ivars, string buffer, array or hash table.
+  unsigned int survive;             //!< number of sweeps to survive.
+} OBJECT;
+
+enum { C_MALLOC, C_REALLOC, C_FREE, C_PERMALLOC, NUM_CALLS };
+static const char *call_names[NUM_CALLS] = { "malloc", "realloc", "free", "permalloc" };
+
+static ESTALLOC *est;
+static OBJECT objects[MAX_OBJECTS];
+static unsigned int num_objects;
+static unsigned long calls[NUM_CALLS];
+static unsigned long type_count[NUM_TYPES];
+static unsigned long failures;
+static uint32_t seed = 1;
+
+
+static uint32_t
+next_random(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+static unsigned int
+next_range(unsigned int min, unsigned int max)
+{
+  return min + next_random() % (max - min + 1);
+}
+
+
+/***** counted allocator calls **********************************************/
+static void *
+vm_malloc(unsigned int size)
+{
+  calls[C_MALLOC]++;
+  void *ptr = est_malloc(est, size);
+  if (ptr == NULL) failures++;
+  return ptr;
+}
+
+static void *
+vm_realloc(void *ptr, unsigned int size)
+{
+  calls[C_REALLOC]++;
+  void *new_ptr = est_realloc(est, ptr, size);
+  if (new_ptr == NULL) failures++;
+  return new_ptr ? new_ptr : ptr;
+}
+
+static void
+vm_free(void *ptr)
+{
+  if (ptr == NULL) return;
+  calls[C_FREE]++;
+  est_free(est, ptr);
+}
+
+static void *
+vm_permalloc(unsigned int size)
+{
+  calls[C_PERMALLOC]++;
+  void *ptr = est_permalloc(est, size);
+  if (ptr == NULL) failures++;
+  return ptr;
+}
+
+
+//================================================================
+/*! VM boot. symbol table, method tables and class objects.
+*/
+static void
+vm_boot(void)
+{
+  for (int i = 0; i < 256; i++) {
+    vm_permalloc(next_range(8, 24));          // symbol entries
+  }
+  for (int i = 0; i < 64; i++) {
+    vm_permalloc(next_range(32, 96));         // method tables
+  }
+  for (int i = 0; i < 40 && num_objects < MAX_OBJECTS; i++) {
+    OBJECT *obj = &objects[num_objects++];    // class objects
+    obj->header = vm_malloc(MRBC_HEADER_SIZE + 16);
+    obj->data = NULL;
+    obj->survive = ~0u;
+  }
+}
+
+
+//================================================================
+/*! create one object, growing its data area as the bytecode would.
+*/
+static void
+new_object(OBJECT *obj)
+{
+  unsigned int type = next_random() % 100;
+  unsigned int n;
+
+  type = (type < 35) ? T_OBJECT : (type < 65) ? T_STRING : (type < 90) ? T_ARRAY : T_HASH;
+  type_count[type]++;
+  obj->header = vm_malloc(MRBC_HEADER_SIZE);
+  obj->data = NULL;
+
+  switch (type) {
+  case T_OBJECT:    // instance variables (key-value table)
+    n = next_random() % 4;
+    if (n) obj->data = vm_malloc(n * (MRBC_VALUE_SIZE + 2));
+    break;
+
+  case T_STRING: {  // literal, then a few appends
+    unsigned int len = next_range(0, 32);
+    obj->data = vm_malloc(len + 1);
+    for (n = next_random() % 5; n > 0; n--) {
+      len += next_range(1, 24);
+      obj->data = vm_realloc(obj->data, len + 1);
+    }
+    break;
+  }
+
+  case T_ARRAY:     // capacity 4, doubles on push
+  case T_HASH: {    // capacity 4 pairs, doubles on store
+    unsigned int unit = MRBC_VALUE_SIZE * (type == T_HASH ? 2 : 1);
+    unsigned int capa = 4;
+    obj->data = vm_malloc(capa * unit);
+    for (n = next_random() % 24; n > capa; capa *= 2) {
+      obj->data = vm_realloc(obj->data, capa * 2 * unit);
+    }
+    break;
+  }
+  }
+
+  // most objects are garbage at the next sweep.
+  obj->survive = (next_random() % 100 < 8) ? next_range(1, 50) : 0;
+}
+
+
+static int
+compare_address(const void *a, const void *b)
+{
+  uintptr_t x = (uintptr_t)*(void *const *)a, y = (uintptr_t)*(void *const *)b;
+  return (x > y) - (x < y);
+}
+
+//================================================================
+/*! free unreachable objects in address order.
+*/
+static void
+gc_sweep(void)
+{
+  static void *garbage[MAX_OBJECTS * 2];
+  unsigned int n = 0, live = 0;
+
+  for (unsigned int i = 0; i < num_objects; i++) {
+    OBJECT *obj = &objects[i];
+    if (obj->survive > 0) {
+      if (obj->survive != ~0u) obj->survive--;
+      objects[live++] = *obj;
+      continue;
+    }
+    if (obj->header) garbage[n++] = obj->header;
+    if (obj->data) garbage[n++] = obj->data;
+  }
+  num_objects = live;
+
+  qsort(garbage, n, sizeof(void *), compare_address);
+  for (unsigned int i = 0; i < n; i++) {
+    vm_free(garbage[i]);
+  }
+}
+
+
+//================================================================
+/*! same number of calls with uniform sizes and random order.
+*/
+static void
+run_uniform(unsigned long num_malloc, unsigned long num_realloc, unsigned long num_permalloc)
+{
+  static void *slots[128];
+  unsigned long total = num_malloc + num_realloc;
+  unsigned int realloc_permil = total ? num_realloc * 1000 / total : 0;
+
+  for (unsigned long i = 0; i < num_permalloc; i++) {
+    vm_permalloc(next_range(8, 96));
+  }
+  for (unsigned long i = 0; i < total; i++) {
+    unsigned int slot = next_random() % 128;
+    if (slots[slot] && next_random() % 1000 < realloc_permil) {
+      slots[slot] = vm_realloc(slots[slot], next_range(8, 512));
+      continue;
+    }
+    vm_free(slots[slot]);
+    slots[slot] = vm_malloc(next_range(8, 512));
+  }
+  for (int i = 0; i < 128; i++) {
+    vm_free(slots[i]);
+  }
+}
+
+
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static void
+print_result(const char *name, unsigned int pool_size, uint64_t elapsed, int print_types)
+{
+  unsigned long total = 0;
+
+  printf("%s profile, pool %u bytes\n", name, pool_size);
+  for (int i = 0; i < NUM_CALLS; i++) {
+    printf("  %-9s %10lu\n", call_names[i], calls[i]);
+    total += calls[i];
+  }
+  for (int i = 0; print_types && i < NUM_TYPES; i++) {
+    printf("  %-9s %10lu objects\n", type_names[i], type_count[i]);
+  }
+  printf("  %.1f ns/call, %lu failures\n", (double)elapsed / total, failures);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  unsigned int pool_size = 1024 * 64;
+  unsigned long bursts = 100000;
+  int uniform = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:b:s:u")) != -1) {
+    switch (opt) {
+    case 'p': pool_size = strtoul(optarg, NULL, 0); break;
+    case 'b': bursts = strtoul(optarg, NULL, 0); break;
+    case 's': seed = strtoul(optarg, NULL, 0); break;
+    case 'u': uniform = 1; break;
+    default:
+      fprintf(stderr, "usage: %s [-p pool_size] [-b bursts] [-s seed] [-u]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  void *pool_memory = malloc(pool_size);
+  est = est_init(pool_memory, pool_size);
+
+  uint64_t t0 = now_ns();
+  vm_boot();
+  for (unsigned long b = 0; b < bursts; b++) {
+    for (int i = 0; i < BURST_OBJECTS && num_objects < MAX_OBJECTS; i++) {
+      new_object(&objects[num_objects++]);
+    }
+    gc_sweep();
+  }
+  print_result("mruby/c", pool_size, now_ns() - t0, 1);
+
+  if (uniform) {
+    unsigned long num_malloc = calls[C_MALLOC];
+    unsigned long num_realloc = calls[C_REALLOC];
+    unsigned long num_permalloc = calls[C_PERMALLOC];
+
+    memset(calls, 0, sizeof(calls));
+    failures = 0;
+    est = est_init(pool_memory, pool_size);
+    t0 = now_ns();
+    run_uniform(num_malloc, num_realloc, num_permalloc);
+    print_result("uniform", pool_size, now_ns() - t0, 0);
+  }
+
+  free(pool_memory);
+  return 0;
+}
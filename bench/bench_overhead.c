@@ -0,0 +1,112 @@
+/*! @file
+  @brief
+  Metadata and internal fragmentation overhead report.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ bench/bench_overhead [-p pool_size] [-s size] [-m min_useful] [-f free_every]
+
+   Fills the pool with requests of the given size (0: mixed 8..256),
+   frees every free_every-th block to leave holes, and prints where
+   the pool memory goes. (est_take_overhead)
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../estalloc.h"
+
+static uint32_t seed = 1;
+
+static uint32_t
+next_random(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+static void
+print_line(const char *name, unsigned int bytes, unsigned int total)
+{
+  printf("  %-28s %8u  %5.1f%%\n", name, bytes, 100.0 * bytes / total);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  unsigned int pool_size = 1024 * 64 - 1;
+  unsigned int size = 16;
+  unsigned int min_useful = 16;
+  unsigned int free_every = 3;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:s:m:f:")) != -1) {
+    switch (opt) {
+    case 'p': pool_size = strtoul(optarg, NULL, 0); break;
+    case 's': size = strtoul(optarg, NULL, 0); break;
+    case 'm': min_useful = strtoul(optarg, NULL, 0); break;
+    case 'f': free_every = strtoul(optarg, NULL, 0); break;
+    default:
+      fprintf(stderr, "usage: %s [-p pool_size] [-s size] [-m min_useful] [-f free_every]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  void *pool_memory = malloc(pool_size);
+  ESTALLOC *est = est_init(pool_memory, pool_size);
+  unsigned int max_blocks = pool_size / 8;
+  void **ptrs = malloc(sizeof(void *) * max_blocks);
+  unsigned int n = 0;
+
+  // fill the pool, then make holes.
+  while (n < max_blocks) {
+    ptrs[n] = est_malloc(est, size ? size : next_random() % 249 + 8);
+    if (ptrs[n] == NULL) break;
+    n++;
+  }
+  for (unsigned int i = 0; free_every && i < n; i += free_every) {
+    est_free(est, ptrs[i]);
+  }
+
+  ESTALLOC_OVERHEAD ovh;
+  est_take_overhead(est, &ovh, min_useful);
+  est_take_statistics(est);
+  unsigned int total = est->stat.total;
+
+  if (size) {
+    printf("pool %u bytes, request %u bytes", total, size);
+  } else {
+    printf("pool %u bytes, request 8..256 bytes", total);
+  }
+  printf(", %u used blocks, %u free blocks\n", ovh.used_blocks, ovh.free_blocks);
+  print_line("MEMORY_POOL header", ovh.pool_header, total);
+  print_line("USED_BLOCK headers", ovh.block_headers, total);
+  print_line("requested", ovh.requested, total);
+#if defined(ESTALLOC_TRACK_REQUESTED_SIZE)
+  print_line("alignment/round-up slack", ovh.slack, total);
+#else
+  printf("  %-28s %8s  (needs ESTALLOC_TRACK_REQUESTED_SIZE)\n", "alignment/round-up slack", "-");
+#endif
+  print_line("free", ovh.free, total);
+  print_line("unusable free (< min_useful)", ovh.unusable_free, total);
+  print_line("permalloc", ovh.permalloc, total);
+  print_line("sentinel", ovh.sentinel, total);
+
+  if (ovh.used_blocks > 0) {
+    printf("  per used block: header %.1f, slack %.1f, requested %.1f bytes\n",
+           (double)ovh.block_headers / ovh.used_blocks, (double)ovh.slack / ovh.used_blocks,
+           (double)ovh.requested / ovh.used_blocks);
+  }
+
+  free(ptrs);
+  free(pool_memory);
+  return 0;
+}
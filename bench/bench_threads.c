@@ -0,0 +1,370 @@
+/*! @file
+  @brief
+  Multi-threaded scalability benchmark with tail latency.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ bench/bench_threads [-t max_threads] [-n ops_per_thread]
+
+  FRONT ENDS
+    locked   one pool, one mutex.
+    sharded  one pool and one mutex per thread. free() finds the owner
+             pool by address, so cross-thread free takes a remote lock.
+    cached   one locked pool, plus a per-thread cache of free blocks
+             for each small size class. The lock is taken only when
+             the cache is empty or full.
+
+  PATTERNS
+    local    every thread frees what it allocated.
+    remote   every thread hands its blocks to the next thread through
+             a ring buffer, and frees what it receives. (producer-consumer)
+
+  For 1, 2, 4 .. max_threads threads, reports throughput, speedup over
+  one thread, p50/p99/p99.9 latency of one call and p50/p99 lock hold time.
+  </pre>
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../estalloc.h"
+
+#define POOL_SIZE     (1024 * 1024 * 4)
+#define MAX_THREADS   64
+#define NUM_SLOTS     64
+#define RING_SIZE     256             // power of two
+#define CACHE_CLASSES 16              // 16 byte steps up to 256 bytes
+#define CACHE_DEPTH   32
+
+enum { LOCKED, SHARDED, CACHED, NUM_MODES };
+enum { LOCAL, REMOTE, NUM_PATTERNS };
+static const char *mode_names[NUM_MODES] = { "locked", "sharded", "cached" };
+static const char *pattern_names[NUM_PATTERNS] = { "local", "remote" };
+
+typedef struct SHARD {
+  pthread_mutex_t lock;
+  uint8_t *top;
+  uint8_t *end;
+} SHARD;
+
+typedef struct RING {
+  void *volatile buf[RING_SIZE];
+  volatile unsigned int head;         //!< written by the consumer.
+  volatile unsigned int tail;         //!< written by the producer.
+  char pad[64];
+} RING;
+
+typedef struct THREAD_CACHE {
+  void *blocks[CACHE_CLASSES][CACHE_DEPTH];
+  unsigned int count[CACHE_CLASSES];
+} THREAD_CACHE;
+
+typedef struct WORKER {
+  pthread_t thread;
+  unsigned int id;
+  uint32_t seed;
+  uint32_t *latency;                  //!< ns per call.
+  uint32_t *hold;                     //!< ns per lock hold.
+  unsigned int num_latency;
+  unsigned int num_hold;
+  THREAD_CACHE cache;
+} WORKER;
+
+static SHARD shards[MAX_THREADS];
+static RING rings[MAX_THREADS];
+static WORKER workers[MAX_THREADS];
+static unsigned int num_threads;
+static unsigned int num_shards;
+static unsigned int ops_per_thread = 200000;
+static int mode, pattern;
+static pthread_barrier_t start_barrier;
+
+
+static inline uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline uint32_t
+next_random(WORKER *w)
+{
+  w->seed = w->seed * 1103515245 + 12345;
+  return w->seed >> 8;
+}
+
+
+/***** locked pool access ***************************************************/
+static void *
+shard_malloc(WORKER *w, SHARD *s, unsigned int size)
+{
+  pthread_mutex_lock(&s->lock);
+  uint64_t t0 = now_ns();
+  void *ptr = est_malloc((ESTALLOC *)s->top, size);
+  w->hold[w->num_hold++] = now_ns() - t0;
+  pthread_mutex_unlock(&s->lock);
+  return ptr;
+}
+
+static void
+shard_free(WORKER *w, SHARD *s, void *ptr)
+{
+  pthread_mutex_lock(&s->lock);
+  uint64_t t0 = now_ns();
+  est_free((ESTALLOC *)s->top, ptr);
+  w->hold[w->num_hold++] = now_ns() - t0;
+  pthread_mutex_unlock(&s->lock);
+}
+
+static SHARD *
+shard_of(void *ptr)
+{
+  for (unsigned int i = 0; i < num_shards; i++) {
+    if (shards[i].top < (uint8_t *)ptr && (uint8_t *)ptr < shards[i].end) {
+      return &shards[i];
+    }
+  }
+  return NULL;
+}
+
+
+/***** front ends ***********************************************************/
+static void *
+bench_malloc(WORKER *w, unsigned int size)
+{
+  switch (mode) {
+  case SHARDED:
+    return shard_malloc(w, &shards[w->id % num_shards], size);
+
+  case CACHED: {
+    unsigned int c = (size - 1) / 16;
+    if (c < CACHE_CLASSES && w->cache.count[c] > 0) {
+      return w->cache.blocks[c][--w->cache.count[c]];
+    }
+    // allocate the class size, so that the block can be reused by the class.
+    return shard_malloc(w, &shards[0], c < CACHE_CLASSES ? (c + 1) * 16 : size);
+  }
+
+  default:
+    return shard_malloc(w, &shards[0], size);
+  }
+}
+
+static void
+bench_free(WORKER *w, void *ptr)
+{
+  switch (mode) {
+  case SHARDED:
+    shard_free(w, shard_of(ptr), ptr);
+    return;
+
+  case CACHED: {
+    // the size field is owned by the caller. other threads may only
+    // change its flag bits, so no lock is needed.
+    unsigned int usable = est_usable_size((ESTALLOC *)shards[0].top, ptr);
+    unsigned int c = usable / 16 - 1;
+    if (usable >= 16 && c < CACHE_CLASSES && w->cache.count[c] < CACHE_DEPTH) {
+      w->cache.blocks[c][w->cache.count[c]++] = ptr;
+      return;
+    }
+    shard_free(w, &shards[0], ptr);
+    return;
+  }
+
+  default:
+    shard_free(w, &shards[0], ptr);
+  }
+}
+
+
+/***** ring buffer for the remote pattern ***********************************/
+static int
+ring_push(RING *r, void *ptr)
+{
+  unsigned int tail = r->tail;
+  if (tail - __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == RING_SIZE) return 0;
+  r->buf[tail % RING_SIZE] = ptr;
+  __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+static void *
+ring_pop(RING *r)
+{
+  unsigned int head = r->head;
+  if (head == __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) return NULL;
+  void *ptr = r->buf[head % RING_SIZE];
+  __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+  return ptr;
+}
+
+
+static void *
+worker_main(void *arg)
+{
+  WORKER *w = arg;
+  void *slots[NUM_SLOTS] = {0};
+  RING *out = &rings[(w->id + 1) % num_threads];
+  RING *in = &rings[w->id];
+
+  pthread_barrier_wait(&start_barrier);
+
+  for (unsigned int i = 0; i < ops_per_thread; i++) {
+    unsigned int slot = next_random(w) % NUM_SLOTS;
+    uint64_t t0 = now_ns();
+
+    if (pattern == REMOTE) {
+      // free one received block, then allocate one and send it.
+      void *ptr = ring_pop(in);
+      if (ptr) {
+        bench_free(w, ptr);
+        w->latency[w->num_latency++] = now_ns() - t0;
+        t0 = now_ns();
+      }
+      ptr = bench_malloc(w, next_random(w) % 248 + 8);
+      if (ptr && !ring_push(out, ptr)) bench_free(w, ptr);
+    }
+    else if (slots[slot]) {
+      bench_free(w, slots[slot]);
+      slots[slot] = NULL;
+    }
+    else {
+      slots[slot] = bench_malloc(w, next_random(w) % 248 + 8);
+    }
+    w->latency[w->num_latency++] = now_ns() - t0;
+  }
+
+  for (unsigned int i = 0; i < NUM_SLOTS; i++) {
+    if (slots[i]) bench_free(w, slots[i]);
+  }
+  return NULL;
+}
+
+
+static int
+compare_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static uint32_t
+percentile(uint32_t *v, unsigned int n, double p)
+{
+  if (n == 0) return 0;
+  return v[(unsigned int)((n - 1) * p)];
+}
+
+
+//================================================================
+/*! run one configuration
+
+  @retval double  throughput in Mops/s.
+*/
+static double
+run(unsigned int threads, double base)
+{
+  static uint32_t *all_latency, *all_hold;
+  unsigned int n_lat = 0, n_hold = 0;
+
+  num_threads = threads;
+  num_shards = (mode == SHARDED) ? threads : 1;
+  for (unsigned int i = 0; i < num_shards; i++) {
+    est_init(shards[i].top, POOL_SIZE);
+  }
+  memset(rings, 0, sizeof(rings));
+  pthread_barrier_init(&start_barrier, NULL, threads + 1);
+
+  for (unsigned int i = 0; i < threads; i++) {
+    WORKER *w = &workers[i];
+    w->id = i;
+    w->seed = i + 1;
+    w->num_latency = w->num_hold = 0;
+    memset(&w->cache, 0, sizeof(w->cache));
+    pthread_create(&w->thread, NULL, worker_main, w);
+  }
+  pthread_barrier_wait(&start_barrier);
+  uint64_t t0 = now_ns();
+  for (unsigned int i = 0; i < threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  uint64_t elapsed = now_ns() - t0;
+  pthread_barrier_destroy(&start_barrier);
+
+  // blocks left in the rings and caches are dropped with the pool.
+  all_latency = realloc(all_latency, sizeof(uint32_t) * threads * ops_per_thread * 2);
+  all_hold = realloc(all_hold, sizeof(uint32_t) * threads * (ops_per_thread * 3 + NUM_SLOTS));
+  for (unsigned int i = 0; i < threads; i++) {
+    memcpy(all_latency + n_lat, workers[i].latency, sizeof(uint32_t) * workers[i].num_latency);
+    n_lat += workers[i].num_latency;
+    memcpy(all_hold + n_hold, workers[i].hold, sizeof(uint32_t) * workers[i].num_hold);
+    n_hold += workers[i].num_hold;
+  }
+  qsort(all_latency, n_lat, sizeof(uint32_t), compare_u32);
+  qsort(all_hold, n_hold, sizeof(uint32_t), compare_u32);
+
+  double mops = (double)threads * ops_per_thread / elapsed * 1000.0;
+  printf("%-8s %-7s %3u  %8.2f  %6.2fx  %6u %6u %7u   %6u %6u\n",
+         mode_names[mode], pattern_names[pattern], threads, mops,
+         base > 0 ? mops / base : 1.0,
+         percentile(all_latency, n_lat, 0.5), percentile(all_latency, n_lat, 0.99),
+         percentile(all_latency, n_lat, 0.999),
+         percentile(all_hold, n_hold, 0.5), percentile(all_hold, n_hold, 0.99));
+  return mops;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  unsigned int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+    switch (opt) {
+    case 't': max_threads = atoi(optarg); break;
+    case 'n': ops_per_thread = atoi(optarg); break;
+    default:
+      fprintf(stderr, "usage: %s [-t max_threads] [-n ops_per_thread]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (max_threads < 1) max_threads = 1;
+  if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+  for (unsigned int i = 0; i < max_threads; i++) {
+    shards[i].top = malloc(POOL_SIZE);
+    shards[i].end = shards[i].top + POOL_SIZE;
+    pthread_mutex_init(&shards[i].lock, NULL);
+    workers[i].latency = malloc(sizeof(uint32_t) * ops_per_thread * 2);
+    workers[i].hold = malloc(sizeof(uint32_t) * (ops_per_thread * 3 + NUM_SLOTS));
+  }
+
+  printf("%-8s %-7s %3s  %8s  %7s  %6s %6s %7s   %6s %6s\n", "frontend", "pattern",
+         "thr", "Mops/s", "speedup", "p50", "p99", "p99.9", "hold50", "hold99");
+  printf("%66s   %13s\n", "(call latency, ns)", "(lock, ns)");
+  for (mode = 0; mode < NUM_MODES; mode++) {
+    for (pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+      double base = 0;
+      for (unsigned int t = 1; t <= max_threads; t = (t < max_threads && t * 2 > max_threads) ? max_threads : t * 2) {
+        double mops = run(t, base);
+        if (t == 1) base = mops;
+      }
+    }
+  }
+
+  return 0;
+}
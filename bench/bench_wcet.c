@@ -0,0 +1,395 @@
+/*! @file
+  @brief
+  Search for allocation sequences that maximize the cost of one call.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ bench/bench_wcet [-m steps|cycles] [-n] [-i iterations] [-s seed] [-o out.seq]
+    $ bench/bench_wcet -r bench/wcet/steps.seq
+
+  STRATEGY
+   A coverage-guided mutation search in the style of libFuzzer.
+   An input is a sequence of operations (malloc, free, realloc and
+   permalloc) on a small pool. Each input is replayed on a fresh pool,
+   and the cost of every call is measured:
+
+    steps   list walk length in one call. Free blocks visited by the
+            first-fit fallback of est_malloc() and blocks visited by
+            est_permalloc() to find the tail. (deterministic)
+    cycles  time stamp counter of one call. (noisy)
+
+   -n excludes est_permalloc(), whose tail search is O(number of blocks)
+   by design, so that the search concentrates on est_malloc().
+
+   Inputs that reach a new (operation, probes fired, cost) feature are
+   kept in the corpus and mutated further. Probes are the USDT probe
+   points of estalloc.c, received through ESTALLOC_TRACE_HOOK, and play
+   the role of code coverage. The input with the most expensive call is
+   written to the output file, which can be replayed later with -r as
+   a regression benchmark.
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+
+#include "../estalloc.h"
+
+#define POOL_SIZE    (1024 * 8)
+#define NUM_SLOTS    64
+#define MAX_OPS      1024
+#define MAX_SIZE     600
+#define CORPUS_SIZE  256
+#define MAX_COST     64         // costs are bucketed up to this for coverage.
+
+enum { OP_MALLOC, OP_FREE, OP_REALLOC, OP_PERMALLOC, NUM_OP_TYPES };
+static const char op_chars[NUM_OP_TYPES] = { 'm', 'f', 'r', 'p' };
+
+typedef struct OP {
+  uint8_t type;
+  uint8_t slot;
+  uint16_t size;
+} OP;
+
+typedef struct INPUT {
+  OP ops[MAX_OPS];
+  unsigned int num_ops;
+} INPUT;
+
+typedef struct RESULT {
+  uint64_t max_cost;
+  unsigned int worst_op;        //!< index of the most expensive call.
+  unsigned int num_new;         //!< number of new coverage features.
+} RESULT;
+
+static uint64_t pool_memory[POOL_SIZE / sizeof(uint64_t)];
+static const char *probe_names[] = {
+  "first_fit", "oom", "split", "merge", "first_fit_step", "permalloc_step",
+};
+#define NUM_PROBES (sizeof(probe_names) / sizeof(probe_names[0]))
+
+static uint8_t coverage[NUM_OP_TYPES][1 << NUM_PROBES][MAX_COST + 1];
+static INPUT corpus[CORPUS_SIZE];
+static unsigned int corpus_count;
+static unsigned long walk_steps;
+static unsigned int probes_fired;     //!< bit set of probe_names.
+static int use_cycles;
+static int no_permalloc;
+static uint32_t seed = 1;
+
+
+//================================================================
+/*! trace hook called by estalloc.c (ESTALLOC_TRACE_HOOK)
+*/
+void
+wcet_trace(const char *probe)
+{
+  for (unsigned int i = 0; i < NUM_PROBES; i++) {
+    if (strcmp(probe, probe_names[i]) == 0) {
+      probes_fired |= 1 << i;
+      break;
+    }
+  }
+  if (strcmp(probe, "first_fit_step") == 0 || strcmp(probe, "permalloc_step") == 0) {
+    walk_steps++;
+  }
+}
+
+static uint32_t
+next_random(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+static uint64_t
+read_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+//================================================================
+/*! replay the input on a fresh pool
+
+  @param  in       input.
+  @param  verbose  print the cost of each call.
+  @retval RESULT   cost.
+*/
+static RESULT
+run_input(const INPUT *in, int verbose)
+{
+  void *slots[NUM_SLOTS] = {0};
+  RESULT r = {0, 0, 0};
+  ESTALLOC *est = est_init(pool_memory, POOL_SIZE);
+
+  for (unsigned int i = 0; i < in->num_ops; i++) {
+    const OP *op = &in->ops[i];
+    void **slot = &slots[op->slot % NUM_SLOTS];
+    void *ptr;
+
+    walk_steps = 0;
+    probes_fired = 0;
+    uint64_t t0 = read_cycles();
+    switch (op->type) {
+    case OP_MALLOC:
+      if (*slot) continue;
+      *slot = est_malloc(est, op->size);
+      break;
+    case OP_FREE:
+      if (!*slot) continue;
+      est_free(est, *slot);
+      *slot = NULL;
+      break;
+    case OP_REALLOC:
+      if (!*slot) continue;
+      ptr = est_realloc(est, *slot, op->size);
+      if (ptr) *slot = ptr;
+      break;
+    case OP_PERMALLOC:
+      if (no_permalloc) continue;
+      est_permalloc(est, op->size);
+      break;
+    }
+    uint64_t t1 = read_cycles();
+
+    uint64_t cost = use_cycles ? t1 - t0 : walk_steps;
+    unsigned int bucket = walk_steps < MAX_COST ? walk_steps : MAX_COST;
+    if (!coverage[op->type][probes_fired][bucket]) {
+      coverage[op->type][probes_fired][bucket] = 1;
+      r.num_new++;
+    }
+    if (cost > r.max_cost) {
+      r.max_cost = cost;
+      r.worst_op = i;
+    }
+    if (verbose) {
+      printf("%4u %c %3u %4u  steps %4lu  cycles %6llu\n", i, op_chars[op->type],
+             op->slot, op->size, walk_steps, (unsigned long long)(t1 - t0));
+    }
+  }
+
+  return r;
+}
+
+
+//================================================================
+/*! cost in cycles mode is the minimum of a few runs to reduce noise.
+*/
+static RESULT
+measure(const INPUT *in)
+{
+  RESULT r = run_input(in, 0);
+  if (!use_cycles) return r;
+
+  for (int i = 0; i < 2; i++) {
+    RESULT r2 = run_input(in, 0);
+    if (r2.max_cost < r.max_cost) r.max_cost = r2.max_cost;
+  }
+  return r;
+}
+
+
+static void
+random_op(OP *op)
+{
+  uint32_t r = next_random();
+  op->type = (r % 16) < 7 ? OP_MALLOC : (r % 16) < 13 ? OP_FREE : (r % 16) < 15 ? OP_REALLOC : OP_PERMALLOC;
+  op->slot = next_random() % NUM_SLOTS;
+  op->size = next_random() % MAX_SIZE + 1;
+  if (op->type == OP_PERMALLOC) {
+    if (no_permalloc) op->type = OP_MALLOC;
+    else op->size = op->size % 32 + 1;
+  }
+}
+
+
+//================================================================
+/*! mutate the input in place
+*/
+static void
+mutate(INPUT *in)
+{
+  int n = next_random() % 4 + 1;
+
+  while (n--) {
+    unsigned int pos = in->num_ops ? next_random() % in->num_ops : 0;
+    switch (next_random() % 6) {
+    case 0:     // insert a random operation
+      if (in->num_ops >= MAX_OPS) break;
+      memmove(&in->ops[pos + 1], &in->ops[pos], (in->num_ops - pos) * sizeof(OP));
+      random_op(&in->ops[pos]);
+      in->num_ops++;
+      break;
+    case 1:     // delete an operation
+      if (in->num_ops == 0) break;
+      memmove(&in->ops[pos], &in->ops[pos + 1], (in->num_ops - pos - 1) * sizeof(OP));
+      in->num_ops--;
+      break;
+    case 2:     // tweak a size
+      if (in->num_ops == 0) break;
+      in->ops[pos].size += (int)(next_random() % 33) - 16;
+      if (in->ops[pos].size == 0 || in->ops[pos].size > MAX_SIZE) in->ops[pos].size = 1;
+      break;
+    case 3:     // replace with a random operation
+      if (in->num_ops == 0) break;
+      random_op(&in->ops[pos]);
+      break;
+    case 4: {   // duplicate a run of operations
+      unsigned int len = next_random() % 16 + 1;
+      if (pos + len > in->num_ops || in->num_ops + len > MAX_OPS) break;
+      memmove(&in->ops[pos + len], &in->ops[pos], (in->num_ops - pos) * sizeof(OP));
+      in->num_ops += len;
+      for (unsigned int i = 0; i < len; i++) {
+        in->ops[pos + len + i].slot = next_random() % NUM_SLOTS;
+      }
+      break;
+    }
+    case 5: {   // splice with another corpus entry
+      const INPUT *other = &corpus[next_random() % corpus_count];
+      if (other->num_ops == 0) break;
+      unsigned int from = next_random() % other->num_ops;
+      unsigned int len = other->num_ops - from;
+      if (pos + len > MAX_OPS) len = MAX_OPS - pos;
+      memcpy(&in->ops[pos], &other->ops[from], len * sizeof(OP));
+      if (pos + len > in->num_ops) in->num_ops = pos + len;
+      break;
+    }
+    }
+  }
+}
+
+
+static int
+save_input(const INPUT *in, const char *filename, const RESULT *r)
+{
+  FILE *fp = fopen(filename, "w");
+  if (fp == NULL) return -1;
+
+  fprintf(fp, "# %s %llu at op %u\n", use_cycles ? "cycles" : "steps",
+          (unsigned long long)r->max_cost, r->worst_op);
+  for (unsigned int i = 0; i < in->num_ops; i++) {
+    fprintf(fp, "%c %u %u\n", op_chars[in->ops[i].type], in->ops[i].slot, in->ops[i].size);
+  }
+  fclose(fp);
+  return 0;
+}
+
+
+static int
+load_input(INPUT *in, const char *filename)
+{
+  FILE *fp = fopen(filename, "r");
+  char line[128], c;
+  unsigned int slot, size;
+
+  if (fp == NULL) return -1;
+  in->num_ops = 0;
+  while (fgets(line, sizeof(line), fp) && in->num_ops < MAX_OPS) {
+    if (sscanf(line, " %c %u %u", &c, &slot, &size) != 3) continue;
+    const char *t = memchr(op_chars, c, NUM_OP_TYPES);
+    if (t == NULL) continue;
+    OP *op = &in->ops[in->num_ops++];
+    op->type = t - op_chars;
+    op->slot = slot % NUM_SLOTS;
+    op->size = size;
+  }
+  fclose(fp);
+  return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *out = "wcet.seq";
+  const char *replay = NULL;
+  unsigned long iterations = 200000;
+  static INPUT in, best;
+  RESULT best_result = {0, 0, 0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      use_cycles = strcmp(argv[++i], "cycles") == 0;
+    } else if (strcmp(argv[i], "-n") == 0) {
+      no_permalloc = 1;
+    } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      iterations = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      seed = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out = argv[++i];
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      replay = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [-m steps|cycles] [-n] [-i iterations] [-s seed] [-o out.seq] [-r in.seq]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (replay) {
+    if (load_input(&in, replay) != 0) {
+      fprintf(stderr, "can't open %s\n", replay);
+      return 1;
+    }
+    RESULT r = measure(&in);
+    RESULT v = run_input(&in, 1);
+    printf("%s: %u ops, worst call #%u, max %s %llu\n", replay, in.num_ops,
+           v.worst_op, use_cycles ? "cycles" : "steps", (unsigned long long)r.max_cost);
+    return 0;
+  }
+
+  // seed corpus: one random input.
+  for (in.num_ops = 0; in.num_ops < 64; in.num_ops++) {
+    random_op(&in.ops[in.num_ops]);
+  }
+  corpus[corpus_count++] = in;
+  best = in;
+  best_result = measure(&in);
+
+  for (unsigned long n = 0; n < iterations; n++) {
+    in = corpus[next_random() % corpus_count];
+    mutate(&in);
+
+    RESULT r = measure(&in);
+    if (r.num_new > 0 || r.max_cost > best_result.max_cost) {
+      if (corpus_count < CORPUS_SIZE) {
+        corpus[corpus_count++] = in;
+      } else {
+        corpus[next_random() % CORPUS_SIZE] = in;
+      }
+    }
+    if (r.max_cost > best_result.max_cost) {
+      best = in;
+      best_result = r;
+      printf("#%lu  max %s %llu at op %u/%u  corpus %u\n", n, use_cycles ? "cycles" : "steps",
+             (unsigned long long)r.max_cost, r.worst_op, in.num_ops, corpus_count);
+    }
+  }
+
+  if (save_input(&best, out, &best_result) != 0) {
+    fprintf(stderr, "can't write %s\n", out);
+    return 1;
+  }
+  printf("worst: %s %llu. saved to %s\n", use_cycles ? "cycles" : "steps",
+         (unsigned long long)best_result.max_cost, out);
+
+  return 0;
+}
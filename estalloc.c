@@ -52,10 +52,16 @@
 # include <stdio.h>
 #include <inttypes.h>
 #endif
+#if defined(ESTALLOC_USDT)
+# include <sys/sdt.h>
+#endif
 //@endcond
 
 /***** Local headers ********************************************************/
 #include "estalloc.h"
+#if defined(ESTALLOC_SIZE_CLASS_HEADER)
+# include ESTALLOC_SIZE_CLASS_HEADER   // generated by tools/est_sizeclass
+#endif
 
 /***** Constant values ******************************************************/
 /*
@@ -94,7 +100,7 @@
 #ifndef ESTALLOC_SLI_BIT_WIDTH
 # define ESTALLOC_SLI_BIT_WIDTH   3
 #endif
-#ifdef PLATFORM_64BIT
+#if defined(PLATFORM_64BIT) && !defined(ESTALLOC_OFFSET_LINK)
 # define ESTALLOC_IGNORE_LSBS    5
 #else
 # ifndef ESTALLOC_IGNORE_LSBS
@@ -115,34 +121,101 @@
 #endif
 
 
+/*
+   Block index (ESTALLOC_BLOCK_INDEX) parameter.
+   Each level reduces 32 bits to 1 bit, so 6 levels cover 2^30 bits.
+*/
+#if !defined(ESTALLOC_BLOCK_INDEX_LEVELS)
+# define ESTALLOC_BLOCK_INDEX_LEVELS 6
+#endif
+
+/*
+   Designated victim (ESTALLOC_DESIGNATED_VICTIM) parameter.
+   Requests up to this block size are served from the victim,
+   and remainders up to this size become the victim.
+*/
+#if !defined(ESTALLOC_VICTIM_MAX_SIZE)
+# define ESTALLOC_VICTIM_MAX_SIZE 256
+#endif
+
+/*
+   est_malloc_hint() parameter.
+   Number of blocks to compare in a bin, to keep the call O(1).
+*/
+#if !defined(ESTALLOC_HINT_SCAN_MAX)
+# define ESTALLOC_HINT_SCAN_MAX 8
+#endif
+
+
 /***** Macros ***************************************************************/
 #define FLI(x) ((x) >> ESTALLOC_SLI_BIT_WIDTH)
 #define SLI(x) ((x) & ((1 << ESTALLOC_SLI_BIT_WIDTH) - 1))
 
+/*
+  Flat bitmap (ESTALLOC_FLAT_BITMAP).
+  One bit per free_blocks index in machine words instead of FLI/SLI
+  two-level bitmap, so that the next non-empty index is found by one
+  masked NLZ per word. (a single word if SIZE_FREE_BLOCKS <= word bits)
+*/
+#if defined(ESTALLOC_FLAT_BITMAP)
+# if defined(PLATFORM_64BIT)
+#  define BITMAP_WORD_T uint64_t
+#  define BITMAP_WORD_BITS 64
+# else
+#  define BITMAP_WORD_T uint32_t
+#  define BITMAP_WORD_BITS 32
+# endif
+# define BITMAP_WORDS ((SIZE_FREE_BLOCKS + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS)
+# define MSB_BIT1_WORD ((BITMAP_WORD_T)1 << (BITMAP_WORD_BITS - 1))
+#endif
+
 
 /***** Typedefs *************************************************************/
+/*
+  link to a free block.
+  With ESTALLOC_OFFSET_LINK, links are offsets from the memory pool
+  instead of pointers, so that the pool works at any mapped address.
+  (e.g. shared memory mapped by processes. see estalloc_shm.c)
+*/
+#if defined(ESTALLOC_OFFSET_LINK) && defined(ESTALLOC_ADDRESS_16BIT)
+typedef uint16_t BLOCK_LINK;
+#elif defined(ESTALLOC_OFFSET_LINK)
+typedef uint32_t BLOCK_LINK;
+#else
+typedef struct FREE_BLOCK *BLOCK_LINK;
+#endif
+
 /*
   define memory block header for 16 bit
 
   (note)
   Typical size of
-    USED_BLOCK is 2 bytes
+    USED_BLOCK is 4 bytes
     FREE_BLOCK is 8 bytes
   on 16bit machine.
+  On 64bit machines (compact mode), USED_BLOCK is 8 bytes with
+  ESTALLOC_ALIGNMENT=8 so that the data is aligned to 8 bytes.
 */
 #if defined(ESTALLOC_ADDRESS_16BIT)
 
 typedef struct USED_BLOCK {
   ESTALLOC_MEMSIZE_T size;    //!< block size, header included
+#if defined(ESTALLOC_TRACK_REQUESTED_SIZE)
+  uint16_t slack;  //!< usable size - requested size
+#else
   uint8_t pad[2];  // for alignment compatibility on 16bit and 32bit machines
+#endif
+#if defined(PLATFORM_64BIT) && ESTALLOC_ALIGNMENT == 8
+  uint8_t pad8[4]; // keep the data aligned to 8 bytes
+#endif
 } USED_BLOCK;
 
 typedef struct FREE_BLOCK {
   ESTALLOC_MEMSIZE_T size;    //!< block size, header included
 
-  struct FREE_BLOCK *next_free;
-  struct FREE_BLOCK *prev_free;
-  struct FREE_BLOCK *top_adrs;    //!< dummy for calculate sizeof(FREE_BLOCK)
+  BLOCK_LINK next_free;
+  BLOCK_LINK prev_free;
+  BLOCK_LINK top_adrs;    //!< dummy for calculate sizeof(FREE_BLOCK)
 } FREE_BLOCK;
 
 
@@ -159,15 +232,19 @@ typedef struct FREE_BLOCK {
 
 typedef struct USED_BLOCK {
   ESTALLOC_MEMSIZE_T size;
+#if defined(ESTALLOC_TRACK_REQUESTED_SIZE)
+  uint16_t slack;  //!< usable size - requested size
+#else
   uint8_t pad[2];  // for alignment compatibility on 16bit and 32bit machines
+#endif
 } USED_BLOCK;
 
 typedef struct FREE_BLOCK {
   ESTALLOC_MEMSIZE_T size;
 
-  struct FREE_BLOCK *next_free;
-  struct FREE_BLOCK *prev_free;
-  struct FREE_BLOCK *top_adrs;    //!< dummy for calculate sizeof(FREE_BLOCK)
+  BLOCK_LINK next_free;
+  BLOCK_LINK prev_free;
+  BLOCK_LINK top_adrs;    //!< dummy for calculate sizeof(FREE_BLOCK)
 } FREE_BLOCK;
 
 #endif
@@ -186,33 +263,177 @@ typedef struct FREE_BLOCK {
 #define IS_PREV_USED(p)     ((p)->size &   0x02)
 #define IS_PREV_FREE(p)     (!IS_PREV_USED(p))
 
+/*
+  Requested size tracking (ESTALLOC_TRACK_REQUESTED_SIZE).
+  The round-up slack is kept in the padding of USED_BLOCK.
+*/
+#if defined(ESTALLOC_TRACK_REQUESTED_SIZE)
+# define SET_REQUESTED(p, req) do { \
+    unsigned int slack_ = BLOCK_SIZE(p) - sizeof(USED_BLOCK) - (req); \
+    ((USED_BLOCK *)(p))->slack = (slack_ > 0xffff) ? 0xffff : slack_; \
+  } while(0)
+#else
+# define SET_REQUESTED(p, req)
+#endif
+
 
 /*
   define memory pool header
+  16bit links do not fill the header up to 8-byte boundary on 32bit
+  machines, so align the free block index. est_init() takes the
+  aligned memory anyway.
 */
+#if defined(ESTALLOC_OFFSET_LINK) && defined(ESTALLOC_ADDRESS_16BIT) && ESTALLOC_ALIGNMENT == 8
+# define FREE_BLOCKS_ALIGN _Alignas(8)
+#else
+# define FREE_BLOCKS_ALIGN
+#endif
+
 typedef struct MEMORY_POOL {
   ESTALLOC est;
 
   ESTALLOC_MEMSIZE_T size;
 
   // free memory bitmap
+#if defined(ESTALLOC_FLAT_BITMAP)
+  BITMAP_WORD_T free_bitmap[BITMAP_WORDS];
+# if BITMAP_WORD_BITS == 32 && (BITMAP_WORDS % 2) != 0
+  uint32_t free_bitmap_pad;   // keep 8-byte alignment on 32bit machines
+# endif
+#else
   uint16_t free_fli_bitmap;
   uint8_t  free_sli_bitmap[ESTALLOC_FLI_BIT_WIDTH +1 +1]; // +1=bit_width, +1=sentinel
   uint8_t  pad[3]; // for alignment compatibility on 16bit and 32bit machines
+#endif
+
+#if defined(ESTALLOC_ISR_RESERVE)
+  // lock-free reserve for interrupt context. see est_malloc_isr().
+  uint32_t isr_head;   // tag (upper 8bit) and link (lower 24bit) of the top block
+  uint32_t isr_count;  // number of blocks in the reserve
+  uint32_t isr_size;   // request size of the reserved blocks
+  uint32_t isr_pad;
+#endif
+
+#if defined(ESTALLOC_BLOCK_INDEX)
+  // hierarchical bitmap of block top addresses. see est_block_of().
+# if defined(ESTALLOC_OFFSET_LINK)
+  uint32_t block_index[ESTALLOC_BLOCK_INDEX_LEVELS];   // offsets from the pool
+# else
+  uint32_t *block_index[ESTALLOC_BLOCK_INDEX_LEVELS];
+# endif
+#endif
+
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+  // last split remainder, kept out of free_blocks. see est_malloc().
+  BLOCK_LINK victim;
+  BLOCK_LINK victim_pad;  // for alignment compatibility on 32bit machines
+#endif
 
   // free memory block index
-  FREE_BLOCK *free_blocks[SIZE_FREE_BLOCKS +1];  // +1=sentinel
+  FREE_BLOCKS_ALIGN BLOCK_LINK free_blocks[SIZE_FREE_BLOCKS +1];  // +1=sentinel
 } MEMORY_POOL;
 
+_Static_assert((sizeof(MEMORY_POOL) & ALIGNMENT_MASK) == 0,
+               "sizeof(MEMORY_POOL) must be a multiple of ESTALLOC_ALIGNMENT");
+
 #define BPOOL_TOP(memory_pool) ((void *)((uint8_t *)(memory_pool) + sizeof(MEMORY_POOL)))
 #define BPOOL_END(memory_pool) ((void *)((uint8_t *)(memory_pool) + ((MEMORY_POOL *)(memory_pool))->size))
 #define BLOCK_ADRS(p) ((void *)((uint8_t *)(p) - sizeof(USED_BLOCK)))
 
+#if defined(ESTALLOC_OFFSET_LINK)
+# define TO_PTR(pool, link) ((link) ? (void *)((uint8_t *)(pool) + (link)) : NULL)
+# define TO_LINK(pool, p)   ((p) ? (BLOCK_LINK)((uint8_t *)(p) - (uint8_t *)(pool)) : 0)
+#else
+# define TO_PTR(pool, link) (link)
+# define TO_LINK(pool, p)   (p)
+#endif
+#define NEXT_FREE(pool, p)  ((FREE_BLOCK *)TO_PTR(pool, (p)->next_free))
+#define PREV_FREE(pool, p)  ((FREE_BLOCK *)TO_PTR(pool, (p)->prev_free))
+#define FREE_LIST(pool, i)  ((FREE_BLOCK *)TO_PTR(pool, (pool)->free_blocks[i]))
+#define VICTIM(pool)        ((FREE_BLOCK *)TO_PTR(pool, (pool)->victim))
+
+// the last word of a free block points to its top. (see est_free())
+#define SET_FOOTER(pool, p) \
+  (*(BLOCK_LINK *)((uint8_t *)(p) + BLOCK_SIZE(p) - sizeof(BLOCK_LINK)) = TO_LINK(pool, p))
+#define PREV_BY_FOOTER(pool, p) \
+  ((FREE_BLOCK *)TO_PTR(pool, *(BLOCK_LINK *)((uint8_t *)(p) - sizeof(BLOCK_LINK))))
+
+#if defined(ESTALLOC_OFFSET_LINK)
+# define INDEX_WORDS(pool, level) ((uint32_t *)((uint8_t *)(pool) + (pool)->block_index[level]))
+#else
+# define INDEX_WORDS(pool, level) ((pool)->block_index[level])
+#endif
+
 #define MSB_BIT1_FLI 0x8000
 #define MSB_BIT1_SLI 0x80
 #define NLZ_FLI(x) nlz16(x)
 #define NLZ_SLI(x) nlz8(x)
 
+/*
+  USDT static probes (ESTALLOC_USDT). provider is "estalloc".
+  Disabled probes are NOPs. e.g.
+    bpftrace -e 'usdt:./a.out:estalloc:first_fit { @[arg1] = count(); }'
+*/
+#if defined(ESTALLOC_USDT)
+# define TRACE1(name, a)           DTRACE_PROBE1(estalloc, name, a)
+# define TRACE2(name, a, b)        DTRACE_PROBE2(estalloc, name, a, b)
+# define TRACE3(name, a, b, c)     DTRACE_PROBE3(estalloc, name, a, b, c)
+# define TRACE4(name, a, b, c, d)  DTRACE_PROBE4(estalloc, name, a, b, c, d)
+#elif defined(ESTALLOC_TRACE_HOOK)
+/*
+  Call a function with the probe name instead. (e.g. bench/bench_wcet.c)
+    -DESTALLOC_TRACE_HOOK=my_hook  and define  void my_hook(const char *);
+*/
+void ESTALLOC_TRACE_HOOK(const char *probe);
+# define TRACE1(name, a)           ESTALLOC_TRACE_HOOK(#name)
+# define TRACE2(name, a, b)        ESTALLOC_TRACE_HOOK(#name)
+# define TRACE3(name, a, b, c)     ESTALLOC_TRACE_HOOK(#name)
+# define TRACE4(name, a, b, c, d)  ESTALLOC_TRACE_HOOK(#name)
+#else
+# define TRACE1(name, a)
+# define TRACE2(name, a, b)
+# define TRACE3(name, a, b, c)
+# define TRACE4(name, a, b, c, d)
+#endif
+
+#if defined(ESTALLOC_ISR_RESERVE)
+/*
+  Atomic primitives for the ISR reserve.
+  Override them (e.g. disabling interrupts) if the target lacks CAS.
+*/
+# if !defined(ESTALLOC_ISR_LOAD)
+#  define ESTALLOC_ISR_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+# endif
+# if !defined(ESTALLOC_ISR_CAS)
+#  define ESTALLOC_ISR_CAS(p, expected, desired) \
+    __atomic_compare_exchange_n((p), (expected), (desired), 0, \
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+# endif
+# define ISR_LINK_MASK 0x00ffffff
+# define ISR_TAG_ONE   0x01000000
+# define ISR_LINK(pool, p) \
+    ((uint32_t)(((uint8_t *)(p) - (uint8_t *)(pool)) / ESTALLOC_ALIGNMENT))
+# define ISR_PTR(pool, link) \
+    ((uint32_t *)((uint8_t *)(pool) + ((link) & ISR_LINK_MASK) * ESTALLOC_ALIGNMENT))
+#endif
+
+#if defined(ESTALLOC_REFCOUNT)
+/*
+  Reference count (ESTALLOC_REFCOUNT) is kept in the first
+  ESTALLOC_ALIGNMENT bytes of the block, next to USED_BLOCK.
+  ESTALLOC_RC_FREE is the free path of the last est_release(). Define it
+  to a locked or remote free function if the pool is shared by threads.
+*/
+# if !defined(ESTALLOC_RC_ADD)
+#  define ESTALLOC_RC_ADD(p, n) __atomic_add_fetch((p), (n), __ATOMIC_ACQ_REL)
+# endif
+# if !defined(ESTALLOC_RC_FREE)
+#  define ESTALLOC_RC_FREE(est, ptr) est_free((est), (ptr))
+# endif
+# define RC_HEADER_SIZE ESTALLOC_ALIGNMENT
+# define RC_COUNT(ptr) ((uint32_t *)((uint8_t *)(ptr) - RC_HEADER_SIZE))
+#endif
+
 
 #if defined(ESTALLOC_DEBUG)
 static void take_profile(ESTALLOC *est);
@@ -261,6 +482,48 @@ nlz8(uint8_t x)
 }
 
 
+#if defined(ESTALLOC_FLAT_BITMAP)
+//================================================================
+/*! Number of leading zeros. flat bitmap word version.
+
+  @param  x  target (not zero)
+  @retval int  nlz value
+*/
+static inline int
+nlz_word(BITMAP_WORD_T x)
+{
+#if defined(__GNUC__)
+  if (sizeof(BITMAP_WORD_T) == sizeof(unsigned long long)) return __builtin_clzll(x);
+  return __builtin_clz(x);
+#else
+  int n = 0;
+  for (int shift = BITMAP_WORD_BITS - 16; shift >= 0; shift -= 16) {
+    uint16_t h = (uint16_t)(x >> shift);
+    if (h != 0) return n + nlz16(h);
+    n += 16;
+  }
+  return n;
+#endif
+}
+#endif
+
+
+#if defined(ESTALLOC_BLOCK_INDEX)
+//================================================================
+/*! Number of leading zeros. 32bit version.
+
+  @param  x  target (32bit unsigned)
+  @retval int  nlz value
+*/
+static inline int
+nlz32(uint32_t x)
+{
+  if ((x >> 16) != 0) return nlz16(x >> 16);
+  return 16 + nlz16(x);
+}
+#endif
+
+
 //================================================================
 /*! calc f and s, and returns fli,sli of free_blocks
 
@@ -268,7 +531,7 @@ nlz8(uint8_t x)
   @retval unsigned int  index of free_blocks
 */
 static inline unsigned int
-calc_index(ESTALLOC_MEMSIZE_T alloc_size)
+calc_tlsf_index(ESTALLOC_MEMSIZE_T alloc_size)
 {
   // check overflow
   if ((alloc_size >> (ESTALLOC_FLI_BIT_WIDTH
@@ -294,6 +557,136 @@ calc_index(ESTALLOC_MEMSIZE_T alloc_size)
 }
 
 
+//================================================================
+/*! Misalignment of the address.
+
+  @param  ptr        target address.
+  @param  alignment  alignment. (power of two)
+  @retval unsigned int  ptr modulo alignment.
+*/
+static inline unsigned int
+misalignment(const void *ptr, unsigned int alignment)
+{
+#if defined(UINTPTR_MAX)
+  return (unsigned int)((uintptr_t)ptr & (alignment - 1));
+#else
+  return (unsigned int)((uint32_t)ptr & (alignment - 1));
+#endif
+}
+
+
+#if defined(ESTALLOC_SIZE_CLASS_HEADER)
+# if ESTALLOC_SIZE_CLASS_ALIGNMENT != ESTALLOC_ALIGNMENT
+#  error "ESTALLOC_SIZE_CLASS_HEADER was generated for another ESTALLOC_ALIGNMENT."
+# endif
+//================================================================
+/*! returns index of free_blocks by the generated size class table.
+
+  Smaller blocks than ESTALLOC_SIZE_CLASS_LIMIT use the table,
+  and larger blocks use TLSF index shifted down next to the table.
+
+  @param  alloc_size  alloc size
+  @retval unsigned int  index of free_blocks
+*/
+static inline unsigned int
+calc_index(ESTALLOC_MEMSIZE_T alloc_size)
+{
+  if (alloc_size < ESTALLOC_SIZE_CLASS_LIMIT) {
+    return est_size_class_index[alloc_size / ESTALLOC_ALIGNMENT];
+  }
+  return calc_tlsf_index(alloc_size)
+         - calc_tlsf_index(ESTALLOC_SIZE_CLASS_LIMIT) + ESTALLOC_SIZE_CLASS_BINS;
+}
+#else
+# define calc_index(alloc_size) calc_tlsf_index(alloc_size)
+#endif
+
+
+//================================================================
+/*! Set the bit of free_blocks index in the bitmap.
+
+  @param  pool   Pointer to ESTALLOC.
+  @param  index  index of free_blocks.
+*/
+static inline void
+set_free_bitmap(MEMORY_POOL *pool, unsigned int index)
+{
+#if defined(ESTALLOC_FLAT_BITMAP)
+  pool->free_bitmap[index / BITMAP_WORD_BITS] |= (MSB_BIT1_WORD >> (index % BITMAP_WORD_BITS));
+#else
+  unsigned int fli = FLI(index);
+  unsigned int sli = SLI(index);
+
+  pool->free_fli_bitmap      |= (MSB_BIT1_FLI >> fli);
+  pool->free_sli_bitmap[fli] |= (MSB_BIT1_SLI >> sli);
+#endif
+}
+
+
+//================================================================
+/*! Clear the bit of free_blocks index in the bitmap.
+
+  @param  pool   Pointer to ESTALLOC.
+  @param  index  index of free_blocks.
+*/
+static inline void
+clear_free_bitmap(MEMORY_POOL *pool, unsigned int index)
+{
+#if defined(ESTALLOC_FLAT_BITMAP)
+  pool->free_bitmap[index / BITMAP_WORD_BITS] &= ~(MSB_BIT1_WORD >> (index % BITMAP_WORD_BITS));
+#else
+  unsigned int fli = FLI(index);
+  unsigned int sli = SLI(index);
+
+  pool->free_sli_bitmap[fli] &= ~(MSB_BIT1_SLI >> sli);
+  if (pool->free_sli_bitmap[fli] == 0 ) pool->free_fli_bitmap &= ~(MSB_BIT1_FLI >> fli);
+#endif
+}
+
+
+//================================================================
+/*! Find the first non-empty free_blocks index at or above index.
+
+  @param  pool   Pointer to ESTALLOC.
+  @param  index  index of free_blocks.
+  @return unsigned int  index of free_blocks.
+  @retval 0      not found.
+*/
+static inline unsigned int
+find_free_index(MEMORY_POOL *pool, unsigned int index)
+{
+#if defined(ESTALLOC_FLAT_BITMAP)
+  // masked NLZ per word.
+  unsigned int w = index / BITMAP_WORD_BITS;
+  if (w >= BITMAP_WORDS) return 0;
+
+  BITMAP_WORD_T masked = pool->free_bitmap[w] & (~(BITMAP_WORD_T)0 >> (index % BITMAP_WORD_BITS));
+  while (masked == 0 && ++w < BITMAP_WORDS) {
+    masked = pool->free_bitmap[w];
+  }
+  if (masked == 0) return 0;
+
+  return w * BITMAP_WORD_BITS + nlz_word(masked);
+#else
+  unsigned int fli = FLI(index);
+  unsigned int sli = SLI(index);
+
+  // check in SLI bitmap table.
+  uint16_t masked = pool->free_sli_bitmap[fli] & (((MSB_BIT1_SLI >> sli) << 1) - 1);
+  if (masked != 0) {
+    return (fli << ESTALLOC_SLI_BIT_WIDTH) + NLZ_SLI(masked);
+  }
+
+  // check in FLI bitmap table.
+  masked = pool->free_fli_bitmap & ((MSB_BIT1_FLI >> fli) - 1);
+  if (masked == 0) return 0;
+
+  fli = NLZ_FLI(masked);
+  return (fli << ESTALLOC_SLI_BIT_WIDTH) + NLZ_SLI(pool->free_sli_bitmap[fli]);
+#endif
+}
+
+
 //================================================================
 /*! Mark that block free and register it in the free index table.
 
@@ -304,24 +697,19 @@ static void
 add_free_block(MEMORY_POOL *pool, FREE_BLOCK *target)
 {
   SET_FREE_BLOCK(target);
-
-  FREE_BLOCK **top_adrs = (FREE_BLOCK **)((uint8_t*)target + BLOCK_SIZE(target) - sizeof(FREE_BLOCK *));
-  *top_adrs = target;
+  SET_FOOTER(pool, target);
 
   unsigned int index = calc_index(BLOCK_SIZE(target));
-  unsigned int fli = FLI(index);
-  unsigned int sli = SLI(index);
   assert(index < SIZE_FREE_BLOCKS);
 
-  pool->free_fli_bitmap      |= (MSB_BIT1_FLI >> fli);
-  pool->free_sli_bitmap[fli] |= (MSB_BIT1_SLI >> sli);
+  set_free_bitmap(pool, index);
 
-  target->prev_free = NULL;
+  target->prev_free = TO_LINK(pool, NULL);
   target->next_free = pool->free_blocks[index];
-  if (target->next_free != NULL) {
-    target->next_free->prev_free = target;
+  if (target->next_free) {
+    NEXT_FREE(pool, target)->prev_free = TO_LINK(pool, target);
   }
-  pool->free_blocks[index] = target;
+  pool->free_blocks[index] = TO_LINK(pool, target);
 }
 
 
@@ -334,38 +722,162 @@ add_free_block(MEMORY_POOL *pool, FREE_BLOCK *target)
 static void
 remove_free_block(MEMORY_POOL *pool, FREE_BLOCK *target)
 {
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+  // the victim is not in the index.
+  if (target == VICTIM(pool)) {
+    pool->victim = TO_LINK(pool, NULL);
+    return;
+  }
+#endif
+
   // top of linked list?
-  if (target->prev_free == NULL) {
+  if (!target->prev_free) {
     unsigned int index = calc_index(BLOCK_SIZE(target));
 
     pool->free_blocks[index] = target->next_free;
-    if (target->next_free == NULL) {
-      unsigned int fli = FLI(index);
-      unsigned int sli = SLI(index);
-      pool->free_sli_bitmap[fli] &= ~(MSB_BIT1_SLI >> sli);
-      if (pool->free_sli_bitmap[fli] == 0 ) pool->free_fli_bitmap &= ~(MSB_BIT1_FLI >> fli);
+    if (!target->next_free) {
+      clear_free_bitmap(pool, index);
     }
   }
   else {
-    target->prev_free->next_free = target->next_free;
+    PREV_FREE(pool, target)->next_free = target->next_free;
+  }
+
+  if (target->next_free) {
+    NEXT_FREE(pool, target)->prev_free = target->prev_free;
+  }
+}
+
+
+//================================================================
+/*! put the remainder of a split back
+
+  With ESTALLOC_DESIGNATED_VICTIM, a small remainder of a small request
+  becomes the victim, and serves the following small requests
+  sequentially. The previous victim goes back to the index.
+  Larger remainders go to the index, so that the victim never holds
+  memory which the other requests have to search for.
+
+  @param  pool        Pointer to ESTALLOC.
+  @param  target      the remainder. (free block)
+  @param  alloc_size  block size of the request that split it.
+*/
+static void
+add_remainder(MEMORY_POOL *pool, FREE_BLOCK *target, ESTALLOC_MEMSIZE_T alloc_size)
+{
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+  if (alloc_size <= ESTALLOC_VICTIM_MAX_SIZE &&
+      BLOCK_SIZE(target) <= ESTALLOC_VICTIM_MAX_SIZE) {
+    if (pool->victim) add_free_block(pool, VICTIM(pool));
+
+    SET_FREE_BLOCK(target);
+    SET_FOOTER(pool, target);
+    pool->victim = TO_LINK(pool, target);
+    return;
   }
+#endif
+  (void)alloc_size;
+  add_free_block(pool, target);
+}
 
-  if (target->next_free != NULL) {
-    target->next_free->prev_free = target->prev_free;
+
+#if defined(ESTALLOC_BLOCK_INDEX)
+# define INDEX_BIT(pool, p) \
+    ((uint32_t)(((uint8_t *)(p) - (uint8_t *)BPOOL_TOP(pool)) / ESTALLOC_ALIGNMENT))
+//================================================================
+/*! Register the block top address in the block index.
+
+  @param  pool    Pointer to ESTALLOC.
+  @param  target  Pointer to target block.
+*/
+static void
+index_set(MEMORY_POOL *pool, void *target)
+{
+  if (!pool->block_index[0]) return;
+
+  uint32_t bit = INDEX_BIT(pool, target);
+  for (int level = 0; level < ESTALLOC_BLOCK_INDEX_LEVELS && pool->block_index[level]; level++) {
+    uint32_t *word = &INDEX_WORDS(pool, level)[bit >> 5];
+    uint32_t before = *word;
+    *word |= (uint32_t)1 << (bit & 31);
+    if (before != 0) break;   // upper levels are already set.
+    bit >>= 5;
   }
 }
 
 
+//================================================================
+/*! Remove the block top address from the block index.
+
+  @param  pool    Pointer to ESTALLOC.
+  @param  target  Pointer to target block.
+*/
+static void
+index_clear(MEMORY_POOL *pool, void *target)
+{
+  if (!pool->block_index[0]) return;
+
+  uint32_t bit = INDEX_BIT(pool, target);
+  for (int level = 0; level < ESTALLOC_BLOCK_INDEX_LEVELS && pool->block_index[level]; level++) {
+    uint32_t *word = &INDEX_WORDS(pool, level)[bit >> 5];
+    *word &= ~((uint32_t)1 << (bit & 31));
+    if (*word != 0) break;    // upper levels must remain set.
+    bit >>= 5;
+  }
+}
+
+
+//================================================================
+/*! Find the nearest registered bit at or below the specified bit.
+
+  It goes up the levels until a non-empty word is found,
+  and then goes down. O(ESTALLOC_BLOCK_INDEX_LEVELS).
+
+  @param  pool  Pointer to ESTALLOC.
+  @param  bit   bit number.
+  @retval int32_t  found bit number.
+  @retval -1       not found.
+*/
+static int32_t
+index_prev(MEMORY_POOL *pool, uint32_t bit)
+{
+  int level = 0;
+
+  while (1) {
+    uint32_t word = INDEX_WORDS(pool, level)[bit >> 5] & (0xffffffff >> (31 - (bit & 31)));
+    if (word != 0) {
+      bit = (bit & ~(uint32_t)31) + (31 - nlz32(word));
+      break;
+    }
+    if ((bit >> 5) == 0) return -1;
+    bit = (bit >> 5) - 1;
+    level++;
+    if (level >= ESTALLOC_BLOCK_INDEX_LEVELS || !pool->block_index[level]) return -1;
+  }
+
+  while (level > 0) {
+    level--;
+    bit = (bit << 5) + (31 - nlz32(INDEX_WORDS(pool, level)[bit]));
+  }
+  return (int32_t)bit;
+}
+#else
+# define index_set(pool, target)
+# define index_clear(pool, target)
+#endif
+
+
 //================================================================
 /*! Split block by size
 
+  @param  pool    Pointer to ESTALLOC.
   @param  target  pointer to target block
   @param  size    size
   @retval NULL    no split.
   @retval FREE_BLOCK *  pointer to splitted free block.
 */
 static inline FREE_BLOCK *
-split_block(FREE_BLOCK *target, ESTALLOC_MEMSIZE_T size)
+split_block(MEMORY_POOL *pool, FREE_BLOCK *target, ESTALLOC_MEMSIZE_T size)
 {
   assert(BLOCK_SIZE(target) >= size);
   if ((BLOCK_SIZE(target) - size) <= ESTALLOC_MIN_MEMORY_BLOCK_SIZE) return NULL;
@@ -375,6 +887,9 @@ split_block(FREE_BLOCK *target, ESTALLOC_MEMSIZE_T size)
 
   split->size = BLOCK_SIZE(target) - size;
   target->size = size | (target->size & ALIGNMENT_MASK);  // copy a size with flags.
+  index_set(pool, split);
+  TRACE3(split, pool, target, BLOCK_SIZE(split));
+  (void)pool;
 
   return split;
 }
@@ -384,19 +899,61 @@ split_block(FREE_BLOCK *target, ESTALLOC_MEMSIZE_T size)
 /*! merge target and next block.
     next will disappear
 
+  @param  pool    Pointer to ESTALLOC.
   @param  target  pointer to free block 1
   @param  next  pointer to free block 2
 */
 static inline
-void merge_block(FREE_BLOCK *target, FREE_BLOCK *next)
+void merge_block(MEMORY_POOL *pool, FREE_BLOCK *target, FREE_BLOCK *next)
 {
   assert(target < next);
 
   // merge target and next
   target->size += BLOCK_SIZE(next);    // copy a size but save flags.
+  index_clear(pool, next);
+  TRACE3(merge, pool, target, BLOCK_SIZE(target));
+  (void)pool;
 }
 
 
+#if defined(ESTALLOC_BLOCK_INDEX)
+//================================================================
+/*! Allocate the block index by permalloc, and register all blocks.
+
+  @param  pool  Pointer to ESTALLOC.
+*/
+static void
+init_block_index(MEMORY_POOL *pool)
+{
+  uint32_t bits = ((uint8_t *)BPOOL_END(pool) - (uint8_t *)BPOOL_TOP(pool)) / ESTALLOC_ALIGNMENT;
+  uint32_t words[ESTALLOC_BLOCK_INDEX_LEVELS];
+  uint32_t total = 0;
+  int levels = 0;
+
+  do {
+    bits = (bits + 31) >> 5;
+    words[levels] = bits;
+    total += bits;
+    levels++;
+  } while (bits > 1 && levels < ESTALLOC_BLOCK_INDEX_LEVELS);
+
+  uint32_t *buf = est_permalloc((ESTALLOC *)pool, total * sizeof(uint32_t));
+  if (buf == NULL) return;  // est_block_of() falls back to walking the blocks.
+
+  for (int level = 0; level < levels; level++) {
+    pool->block_index[level] = TO_LINK(pool, buf);
+    for (uint32_t i = 0; i < words[level]; i++) *buf++ = 0;
+  }
+
+  USED_BLOCK *block = BPOOL_TOP(pool);
+  while (block < (USED_BLOCK *)BPOOL_END(pool)) {
+    index_set(pool, block);
+    block = PHYS_NEXT(block);
+  }
+}
+#endif
+
+
 /***** Global functions *****************************************************/
 //================================================================
 /*! initialize
@@ -417,6 +974,9 @@ est_init(void *ptr, unsigned int size)
   */
 
   assert((sizeof(MEMORY_POOL) & ALIGNMENT_MASK) == 0);
+#if defined(ESTALLOC_SIZE_CLASS_HEADER)
+  assert(ESTALLOC_SIZE_CLASS_BINS <= calc_tlsf_index(ESTALLOC_SIZE_CLASS_LIMIT));
+#endif
 #if defined(UINTPTR_MAX)
   assert(((uintptr_t)ptr & ALIGNMENT_MASK) == 0);
 #else
@@ -445,6 +1005,10 @@ est_init(void *ptr, unsigned int size)
 
   add_free_block(memory_pool, free_block);
 
+#if defined(ESTALLOC_BLOCK_INDEX)
+  init_block_index(memory_pool);
+#endif
+
   return (ESTALLOC *)memory_pool;
 }
 
@@ -471,6 +1035,24 @@ est_cleanup(ESTALLOC *est)
 }
 
 
+//================================================================
+/*! minimum size of a memory pool
+
+  Pool header, the smallest block and the sentinel. Smaller memory
+  than this must not be given to est_init().
+
+  @retval unsigned int  size in bytes.
+*/
+unsigned int
+est_min_pool_size(void)
+{
+  unsigned int sentinel_size = sizeof(USED_BLOCK);
+  sentinel_size += (-sentinel_size & ALIGNMENT_MASK);
+
+  return sizeof(MEMORY_POOL) + ESTALLOC_MIN_MEMORY_BLOCK_SIZE + sentinel_size;
+}
+
+
 //================================================================
 /*! allocate memory
 
@@ -485,111 +1067,370 @@ est_malloc(ESTALLOC *est, unsigned int size)
   MEMORY_POOL *pool = (MEMORY_POOL *)est;
   ESTALLOC_MEMSIZE_T alloc_size = size + sizeof(USED_BLOCK);
 
+  TRACE2(malloc_entry, est, size);
+
   alloc_size += (-alloc_size & ALIGNMENT_MASK);
 
   // check minimum alloc size.
   if (alloc_size < ESTALLOC_MIN_MEMORY_BLOCK_SIZE ) alloc_size = ESTALLOC_MIN_MEMORY_BLOCK_SIZE;
 
   if ((uint8_t *)BPOOL_END(pool) - alloc_size < (uint8_t *)BPOOL_TOP(pool)) {
-    return NULL; // request size is too large.
+    goto OUT_OF_MEMORY; // request size is too large.
   }
 
   FREE_BLOCK *target;
-  unsigned int fli, sli;
   unsigned int index = calc_index(alloc_size);
 
   // At first, check only the beginning of the same size block.
   // because it immediately responds to the pattern in which
   // same size memory are allocated and released continuously.
-  target = pool->free_blocks[index];
-  if (target && BLOCK_SIZE(target) >= alloc_size) {
-    fli = FLI(index);
-    sli = SLI(index);
-    goto FOUND_TARGET_BLOCK;
+  target = FREE_LIST(pool, index);
+  if (target && BLOCK_SIZE(target) >= alloc_size) goto FOUND_TARGET_BLOCK;
+
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+  // small request? carve it from the victim, next to the previous one.
+  target = VICTIM(pool);
+  if (alloc_size <= ESTALLOC_VICTIM_MAX_SIZE && target && BLOCK_SIZE(target) >= alloc_size) {
+    pool->victim = TO_LINK(pool, NULL);
+    goto SPLIT_BLOCK;
   }
+#endif
 
   // and then, check the next (larger) size block.
-  target = pool->free_blocks[++index];
-  fli = FLI(index);
-  sli = SLI(index);
+  index++;
+  target = FREE_LIST(pool, index);
   if (target) goto FOUND_TARGET_BLOCK;
 
-  // check in SLI bitmap table.
-  uint16_t masked = pool->free_sli_bitmap[fli] & ((MSB_BIT1_SLI >> sli) - 1);
-  if (masked != 0) {
-    sli = NLZ_SLI(masked);
-    goto FOUND_FLI_SLI;
-  }
-
-  // check in FLI bitmap table.
-  masked = pool->free_fli_bitmap & ((MSB_BIT1_FLI >> fli) - 1);
-  if (masked != 0) {
-    fli = NLZ_FLI(masked);
-    sli = NLZ_SLI(pool->free_sli_bitmap[fli]);
-    goto FOUND_FLI_SLI;
+  // check in bitmap table.
+  unsigned int found = find_free_index(pool, index);
+  if (found != 0) {
+    index = found;
+    goto FOUND_INDEX;
   }
 
   // Change strategy to First-fit.
-  target = pool->free_blocks[--index];
+  index--;
+  target = FREE_LIST(pool, index);
+  TRACE3(first_fit, est, size, index);
   while (target) {
+    TRACE2(first_fit_step, est, target);
     if (BLOCK_SIZE(target) >= alloc_size) {
       remove_free_block( pool, target);
       goto SPLIT_BLOCK;
     }
-    target = target->next_free;
+    target = NEXT_FREE(pool, target);
   }
 
   // else out of memory
-  return NULL;
+  goto OUT_OF_MEMORY;
 
- FOUND_FLI_SLI:
-  index = (fli << ESTALLOC_SLI_BIT_WIDTH) + sli;
+ FOUND_INDEX:
   assert(index <= SIZE_FREE_BLOCKS);
-  target = pool->free_blocks[index];
+  target = FREE_LIST(pool, index);
   //assert(target != NULL);
   if (target == NULL) {
-    return NULL;
+    goto OUT_OF_MEMORY;
   }
 
  FOUND_TARGET_BLOCK:
   if ((uint8_t *)target + alloc_size > (uint8_t *)BPOOL_END(pool)) {
-    return NULL; // Check pool boundary.
+    goto OUT_OF_MEMORY; // Check pool boundary.
   }
   assert(BLOCK_SIZE(target) >= alloc_size);
 
   // remove free_blocks index
   pool->free_blocks[index] = target->next_free;
-  if (target->next_free == NULL) {
-    pool->free_sli_bitmap[fli] &= ~(MSB_BIT1_SLI >> sli);
-    if (pool->free_sli_bitmap[fli] == 0 ) pool->free_fli_bitmap &= ~(MSB_BIT1_FLI >> fli);
+  if (!target->next_free) {
+    clear_free_bitmap(pool, index);
   }
   else {
-    target->next_free->prev_free = NULL;
+    NEXT_FREE(pool, target)->prev_free = TO_LINK(pool, NULL);
+  }
+
+ SPLIT_BLOCK: {
+    FREE_BLOCK *release = split_block(pool, target, alloc_size);
+    if (release != NULL) {
+      SET_PREV_USED(release);
+      add_remainder(pool, release, alloc_size);
+    } else {
+      FREE_BLOCK *next = PHYS_NEXT(target);
+      SET_PREV_USED(next);
+    }
+  }
+
+  SET_USED_BLOCK(target);
+  SET_REQUESTED(target, size);
+
+#if defined(ESTALLOC_DEBUG)
+  char *p = (char *)target;
+  for (unsigned int i = 0; i < alloc_size - sizeof(USED_BLOCK); i++) {
+    p[sizeof(USED_BLOCK) + i] = 0xaa;
   }
+#endif
+
+  PROFILE();
+  TRACE4(malloc_return, est, (uint8_t *)target + sizeof(USED_BLOCK), size, index);
+
+  return (uint8_t *)target + sizeof(USED_BLOCK);
+
+ OUT_OF_MEMORY:
+  TRACE2(oom, est, size);
+  return NULL;
+}
+
+
+//================================================================
+/*! allocate memory, and tell the real usable size
+
+  @param  est     Pointer to ESTALLOC.
+  @param  size    request size.
+  @param  usable  (out) usable size of the block. (>= size) 0 if failed.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+void *
+est_malloc_sized(ESTALLOC *est, unsigned int size, unsigned int *usable)
+{
+  void *ptr = est_malloc(est, size);
+  if (usable) {
+    *usable = ptr ? (unsigned int)(BLOCK_SIZE((USED_BLOCK *)BLOCK_ADRS(ptr)) - sizeof(USED_BLOCK)) : 0;
+  }
+  return ptr;
+}
+
+
+//================================================================
+/*! usable size that est_malloc() gives at least for the request size
+
+  The block may be larger, when the rest is too small to split.
+  (see est_malloc_sized())
+
+  @param  size    request size.
+  @retval unsigned int  usable size.
+  @retval 0             too large.
+*/
+unsigned int
+est_good_size(unsigned int size)
+{
+  if (size > (ESTALLOC_MEMSIZE_T)(~0) - sizeof(USED_BLOCK) - ALIGNMENT_MASK) return 0;
+
+  ESTALLOC_MEMSIZE_T alloc_size = size + sizeof(USED_BLOCK);
+  alloc_size += (-alloc_size & ALIGNMENT_MASK);
+  if (alloc_size < ESTALLOC_MIN_MEMORY_BLOCK_SIZE) alloc_size = ESTALLOC_MIN_MEMORY_BLOCK_SIZE;
+
+  return alloc_size - sizeof(USED_BLOCK);
+}
+
+
+//================================================================
+/*! allocate memory with a lifetime hint
+
+  Long-lived requests take the highest-address block in the bin and
+  its upper part, short-lived ones the lowest-address block and its
+  lower part. Temporaries then coalesce into large free blocks
+  instead of being pinned between long-lived objects.
+  Only the first ESTALLOC_HINT_SCAN_MAX blocks of a bin are compared.
+
+  @param  est     Pointer to ESTALLOC.
+  @param  size    request size.
+  @param  hint    EST_HINT_LONG_LIVED or EST_HINT_SHORT_LIVED.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+void *
+est_malloc_hint(ESTALLOC *est, unsigned int size, int hint)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+  int high = hint & EST_HINT_LONG_LIVED;
+
+  if (!(hint & (EST_HINT_LONG_LIVED|EST_HINT_SHORT_LIVED))) return est_malloc(est, size);
+
+  ESTALLOC_MEMSIZE_T alloc_size = size + sizeof(USED_BLOCK);
+  alloc_size += (-alloc_size & ALIGNMENT_MASK);
+  if (alloc_size < ESTALLOC_MIN_MEMORY_BLOCK_SIZE ) alloc_size = ESTALLOC_MIN_MEMORY_BLOCK_SIZE;
+  if ((uint8_t *)BPOOL_END(pool) - alloc_size < (uint8_t *)BPOOL_TOP(pool)) {
+    return NULL;
+  }
+
+  // search the same size bin, and then the first larger bin.
+  FREE_BLOCK *target = NULL;
+  FREE_BLOCK *block;
+  unsigned int index = calc_index(alloc_size);
+  unsigned int n = 0;
+  for (block = FREE_LIST(pool, index); block && n < ESTALLOC_HINT_SCAN_MAX;
+       block = NEXT_FREE(pool, block), n++) {
+    if (BLOCK_SIZE(block) < alloc_size) continue;
+    if (!target || (high ? block > target : block < target)) target = block;
+  }
+  if (!target) {
+    index = find_free_index(pool, index + 1);
+    if (index == 0) return est_malloc(est, size);  // first-fit and others.
+
+    n = 0;
+    for (block = FREE_LIST(pool, index); block && n < ESTALLOC_HINT_SCAN_MAX;
+         block = NEXT_FREE(pool, block), n++) {
+      if (!target || (high ? block > target : block < target)) target = block;
+    }
+  }
+
+  // served here. (est_malloc() traces the others by itself)
+  TRACE2(malloc_entry, est, size);
+  remove_free_block(pool, target);
+
+  ESTALLOC_MEMSIZE_T free_size = BLOCK_SIZE(target) - alloc_size;
+  if (free_size <= ESTALLOC_MIN_MEMORY_BLOCK_SIZE) {
+    // no split, use all
+  } else if (high) {
+    // keep the lower part free, use the upper part.
+    FREE_BLOCK *upper = (FREE_BLOCK *)((uint8_t *)target + free_size);
+    upper->size = alloc_size;   // with prev free.
+    target->size -= alloc_size; // w/ flags.
+    index_set(pool, upper);
+    TRACE3(split, pool, target, free_size);
+    add_free_block(pool, target);
+    target = upper;
+  } else {
+    FREE_BLOCK *release = split_block(pool, target, alloc_size);
+    SET_PREV_USED(release);
+    add_free_block(pool, release);
+  }
+
+  SET_PREV_USED((FREE_BLOCK *)PHYS_NEXT(target));
+  SET_USED_BLOCK(target);
+  SET_REQUESTED(target, size);
+
+#if defined(ESTALLOC_DEBUG)
+  char *p = (char *)target;
+  for (unsigned int i = 0; i < BLOCK_SIZE(target) - sizeof(USED_BLOCK); i++) {
+    p[sizeof(USED_BLOCK) + i] = 0xaa;
+  }
+#endif
+
+  PROFILE();
+  TRACE4(malloc_return, est, (uint8_t *)target + sizeof(USED_BLOCK), size, index);
+
+  return (uint8_t *)target + sizeof(USED_BLOCK);
+}
+
+
+//================================================================
+/*! allocate memory in segments, when no contiguous block is available
+
+  Segments are whole free blocks taken from the largest bins (and the
+  victim of ESTALLOC_DESIGNATED_VICTIM at last), and the last one is
+  split. The sum of iov_len is total.
+
+  @param  est           Pointer to ESTALLOC.
+  @param  total         request size.
+  @param  max_segments  number of elements of iov.
+  @param  iov           (out) segments.
+  @return unsigned int  number of segments.
+  @retval 0             Out of memory. (nothing is allocated)
+*/
+unsigned int
+est_malloc_sg(ESTALLOC *est, unsigned int total, unsigned int max_segments, ESTALLOC_IOVEC iov[])
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+  if (total == 0 || max_segments == 0) return 0;
+
+  // contiguous, if possible.
+  iov[0].iov_base = est_malloc(est, total);
+  if (iov[0].iov_base) {
+    iov[0].iov_len = total;
+    return 1;
+  }
+
+  // est_malloc() has ended with oom. the segments are a new request.
+  TRACE2(malloc_entry, est, total);
+
+  // enough free blocks in the largest bins?
+  unsigned int n = 0;
+  unsigned int capacity = 0;
+  int index;
+  for (index = SIZE_FREE_BLOCKS - 1; index >= 0 && capacity < total; index--) {
+    FREE_BLOCK *block;
+    for (block = FREE_LIST(pool, index); block && capacity < total; block = NEXT_FREE(pool, block)) {
+      if (n == max_segments) return 0;
+      capacity += BLOCK_SIZE(block) - sizeof(USED_BLOCK);
+      n++;
+    }
+  }
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+  unsigned int n_bins = n;
+  // the victim is not in the bins. it becomes the last segment.
+  if (capacity < total && pool->victim) {
+    if (n == max_segments) return 0;
+    capacity += BLOCK_SIZE(VICTIM(pool)) - sizeof(USED_BLOCK);
+    n++;
+  }
+#endif
+  if (capacity < total) return 0;
+
+  // take them in the same order.
+  unsigned int remain = total;
+  index = SIZE_FREE_BLOCKS - 1;
+  for (unsigned int i = 0; i < n; i++) {
+    FREE_BLOCK *target;
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+    if (i == n_bins) {
+      target = VICTIM(pool);
+    } else
+#endif
+    {
+      while (!pool->free_blocks[index]) index--;
+      target = FREE_LIST(pool, index);
+    }
+    remove_free_block(pool, target);
+
+    ESTALLOC_MEMSIZE_T usable = BLOCK_SIZE(target) - sizeof(USED_BLOCK);
+    ESTALLOC_MEMSIZE_T len = usable < remain ? usable : remain;
+    ESTALLOC_MEMSIZE_T alloc_size = len + sizeof(USED_BLOCK);
+    alloc_size += (-alloc_size & ALIGNMENT_MASK);
+    if (alloc_size < ESTALLOC_MIN_MEMORY_BLOCK_SIZE ) alloc_size = ESTALLOC_MIN_MEMORY_BLOCK_SIZE;
 
- SPLIT_BLOCK: {
-    FREE_BLOCK *release = split_block(target, alloc_size);
+    FREE_BLOCK *release = split_block(pool, target, alloc_size);
     if (release != NULL) {
       SET_PREV_USED(release);
       add_free_block(pool, release);
     } else {
-      FREE_BLOCK *next = PHYS_NEXT(target);
-      SET_PREV_USED(next);
+      SET_PREV_USED((FREE_BLOCK *)PHYS_NEXT(target));
     }
-  }
-
-  SET_USED_BLOCK(target);
+    SET_USED_BLOCK(target);
+    SET_REQUESTED(target, len);
 
 #if defined(ESTALLOC_DEBUG)
-  char *p = (char *)target;
-  for (unsigned int i = 0; i < alloc_size - sizeof(USED_BLOCK); i++) {
-    p[sizeof(USED_BLOCK) + i] = 0xaa;
-  }
+    char *p = (char *)target;
+    for (unsigned int j = 0; j < alloc_size - sizeof(USED_BLOCK); j++) {
+      p[sizeof(USED_BLOCK) + j] = 0xaa;
+    }
 #endif
 
+    iov[i].iov_base = (uint8_t *)target + sizeof(USED_BLOCK);
+    iov[i].iov_len = len;
+    remain -= len;
+    TRACE4(malloc_return, est, iov[i].iov_base, len, index);
+  }
   PROFILE();
 
-  return (uint8_t *)target + sizeof(USED_BLOCK);
+  return n;
+}
+
+
+//================================================================
+/*! release the segments of est_malloc_sg()
+
+  @param  est           Pointer to ESTALLOC.
+  @param  num_segments  Return value of est_malloc_sg()
+  @param  iov           segments.
+*/
+void
+est_free_sg(ESTALLOC *est, unsigned int num_segments, ESTALLOC_IOVEC iov[])
+{
+  for (unsigned int i = 0; i < num_segments; i++) {
+    est_free(est, iov[i].iov_base);
+    iov[i].iov_base = NULL;
+    iov[i].iov_len = 0;
+  }
 }
 
 
@@ -607,10 +1448,13 @@ est_permalloc(ESTALLOC *est, unsigned int size)
   MEMORY_POOL *pool = (MEMORY_POOL *)est;
   ESTALLOC_MEMSIZE_T alloc_size = size + (-size & ALIGNMENT_MASK);
 
+  TRACE2(permalloc_entry, est, size);
+
   // find the tail block
   FREE_BLOCK *tail = BPOOL_TOP(pool);
   FREE_BLOCK *prev;
   do {
+    TRACE2(permalloc_step, est, tail);
     prev = tail;
     tail = PHYS_NEXT(tail);
   } while (PHYS_NEXT(tail) < BPOOL_END(pool));
@@ -625,14 +1469,17 @@ est_permalloc(ESTALLOC *est, unsigned int size)
   if (free_size <= ESTALLOC_MIN_MEMORY_BLOCK_SIZE) {
     // no split, use all
     prev->size += BLOCK_SIZE(tail);
+    index_clear(pool, tail);
     SET_USED_BLOCK( prev);
     tail = prev;
   }
   else {
     // split block
     ESTALLOC_MEMSIZE_T tail_size = tail->size + alloc_size;  // w/ flags.
+    index_clear(pool, tail);
     tail = (FREE_BLOCK*)((uint8_t *)tail - alloc_size);
     tail->size = tail_size;
+    index_set(pool, tail);
     prev->size -= alloc_size;    // w/ flags.
     add_free_block( pool, prev);
 
@@ -644,10 +1491,59 @@ est_permalloc(ESTALLOC *est, unsigned int size)
 #endif
   }
 
+  TRACE3(permalloc_return, est, (uint8_t *)tail + sizeof(USED_BLOCK), size);
   return (uint8_t *)tail + sizeof(USED_BLOCK);
 
- FALLBACK:
-  return est_malloc(est, size);
+ FALLBACK: {
+    void *ptr = est_malloc(est, size);
+    TRACE3(permalloc_return, est, ptr, size);
+    return ptr;
+  }
+}
+
+
+//================================================================
+/*! allocate memory aligned to the specified boundary
+
+  @param  est        Pointer to ESTALLOC.
+  @param  alignment  alignment. (power of two)
+  @param  size       request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  error.
+*/
+void *
+est_memalign(ESTALLOC *est, unsigned int alignment, unsigned int size)
+{
+  if (alignment <= ESTALLOC_ALIGNMENT) return est_malloc(est, size);
+  if ((alignment & (alignment - 1)) != 0) return NULL;
+
+  // over-allocate, so that an aligned address leaving enough room
+  // for a leading free block can always be found.
+  // the aligned block must hold a minimum block, or est_realloc() moves it.
+  unsigned int extra = alignment + ESTALLOC_MIN_MEMORY_BLOCK_SIZE;
+  unsigned int request = (size < ESTALLOC_MIN_MEMORY_BLOCK_SIZE) ? ESTALLOC_MIN_MEMORY_BLOCK_SIZE : size;
+  if (extra > (ESTALLOC_MEMSIZE_T)(~0) ||
+      request > (ESTALLOC_MEMSIZE_T)(~0) - extra) return NULL;
+  uint8_t *ptr = est_malloc(est, request + extra);
+  if (ptr == NULL) return NULL;
+
+  if (misalignment(ptr, alignment) != 0) {
+    // split off the leading part as a used block, and release it.
+    ESTALLOC_MEMSIZE_T gap = ESTALLOC_MIN_MEMORY_BLOCK_SIZE;
+    gap += (alignment - misalignment(ptr + gap, alignment)) & (alignment - 1);
+    uint8_t *aligned = ptr + gap;
+    USED_BLOCK *head = BLOCK_ADRS(ptr);
+    USED_BLOCK *target = BLOCK_ADRS(aligned);
+
+    target->size = (BLOCK_SIZE(head) - gap) | 0x03;   // flag prev=1, used=1
+    head->size = gap | (head->size & ALIGNMENT_MASK);  // copy a size with flags.
+    index_set((MEMORY_POOL *)est, target);
+    est_free(est, ptr);
+    ptr = aligned;
+  }
+
+  // shrink the tail. it never moves the block.
+  return est_realloc(est, ptr, size);
 }
 
 
@@ -687,6 +1583,7 @@ est_free(ESTALLOC *est, void *ptr)
   MEMORY_POOL *pool = (MEMORY_POOL *)est;
 
   if (ptr == NULL) return;
+  TRACE2(free_entry, est, ptr);
 
 #if defined(ESTALLOC_DEBUG)
   {
@@ -736,18 +1633,18 @@ est_free(ESTALLOC *est, void *ptr)
 
   if (IS_FREE_BLOCK(next)) {
     remove_free_block( pool, next);
-    merge_block(target, next);
+    merge_block(pool, target, next);
   } else {
     SET_PREV_FREE(next);
   }
 
   // check prev block, merge?
   if (IS_PREV_FREE(target)) {
-    FREE_BLOCK *prev = *((FREE_BLOCK **)((uint8_t*)target - sizeof(FREE_BLOCK *)));
+    FREE_BLOCK *prev = PREV_BY_FOOTER(pool, target);
 
     assert(IS_FREE_BLOCK(prev));
     remove_free_block( pool, prev);
-    merge_block(prev, target);
+    merge_block(pool, prev, target);
     target = prev;
   }
 
@@ -755,6 +1652,7 @@ est_free(ESTALLOC *est, void *ptr)
   add_free_block( pool, target);
 
   PROFILE();
+  TRACE3(free_return, est, target, BLOCK_SIZE(target));
 }
 
 
@@ -777,6 +1675,8 @@ est_realloc(ESTALLOC *est, void *ptr, unsigned int size)
   ESTALLOC_MEMSIZE_T alloc_size = size + sizeof(USED_BLOCK);
   FREE_BLOCK *next;
 
+  TRACE3(realloc_entry, est, ptr, size);
+
   alloc_size += (-alloc_size & ALIGNMENT_MASK);
 
   // check minimum alloc size.
@@ -790,44 +1690,132 @@ est_realloc(ESTALLOC *est, void *ptr, unsigned int size)
     if ((BLOCK_SIZE(target) + BLOCK_SIZE(next)) < alloc_size) goto ALLOC_AND_COPY;
 
     remove_free_block(pool, next);
-    merge_block((FREE_BLOCK *)target, next);
+    merge_block(pool, (FREE_BLOCK *)target, next);
   }
   next = PHYS_NEXT(target);
 
   // try shrink.
-  FREE_BLOCK *release = split_block((FREE_BLOCK *)target, alloc_size);
+  FREE_BLOCK *release = split_block(pool, (FREE_BLOCK *)target, alloc_size);
   if (release != NULL) {
     SET_PREV_USED(release);
   } else {
     SET_PREV_USED(next);
+    SET_REQUESTED(target, size);
     PROFILE();
+    TRACE3(realloc_return, est, ptr, size);
     return ptr;
   }
 
   // check next block, merge?
   if (IS_FREE_BLOCK(next)) {
     remove_free_block( pool, next);
-    merge_block(release, next);
+    merge_block(pool, release, next);
   } else {
     SET_PREV_FREE(next);
   }
   add_free_block(pool, release);
+  SET_REQUESTED(target, size);
   PROFILE();
+  TRACE3(realloc_return, est, ptr, size);
   return ptr;
 
   // expand part2.
   // new alloc and copy
  ALLOC_AND_COPY: {
     void *new_ptr = est_malloc(est, size);
+    TRACE3(realloc_return, est, new_ptr, size);
     if (new_ptr == NULL) return NULL;  // ENOMEM
 
-    // At this point, BLOCK_SIZE(target) is new alloc size.
-    for (unsigned int i = 0; i < BLOCK_SIZE(target) - sizeof(USED_BLOCK); i++) {
-      ((uint8_t *)new_ptr)[i] = ((uint8_t *)ptr)[i];
+    return est_move(est, ptr, new_ptr, size);
+  }
+}
+
+
+//================================================================
+/*! expand the block in place, never moves it
+
+  Merges the next free block, and keeps up to max_size of it.
+  Use it to choose between in-place growth and an amortized copy.
+
+  @param  est       Pointer to ESTALLOC.
+  @param  ptr       Return value of est_malloc()
+  @param  min_size  needed usable size.
+  @param  max_size  wanted usable size.
+  @retval unsigned int  new usable size. (>= min_size)
+  @retval 0             can't expand. nothing is changed.
+*/
+unsigned int
+est_try_expand(ESTALLOC *est, void *ptr, unsigned int min_size, unsigned int max_size)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+  FREE_BLOCK *target = BLOCK_ADRS(ptr);
+  FREE_BLOCK *next = PHYS_NEXT(target);
+
+  if (max_size < min_size) max_size = min_size;
+  if (max_size > (ESTALLOC_MEMSIZE_T)(~0) - sizeof(USED_BLOCK) - ALIGNMENT_MASK) {
+    max_size = (ESTALLOC_MEMSIZE_T)(~0) - sizeof(USED_BLOCK) - ALIGNMENT_MASK;
+  }
+  if (min_size > max_size) return 0;
+
+  ESTALLOC_MEMSIZE_T alloc_size = max_size + sizeof(USED_BLOCK);
+  alloc_size += (-alloc_size & ALIGNMENT_MASK);
+  if (alloc_size < ESTALLOC_MIN_MEMORY_BLOCK_SIZE) alloc_size = ESTALLOC_MIN_MEMORY_BLOCK_SIZE;
+
+  // already enough, or the next block can't be merged.
+  if (BLOCK_SIZE(target) >= alloc_size || IS_USED_BLOCK(next)) goto NO_MERGE;
+  if (BLOCK_SIZE(target) + BLOCK_SIZE(next) - sizeof(USED_BLOCK) < min_size) goto NO_MERGE;
+
+  remove_free_block(pool, next);
+  merge_block(pool, target, next);
+  next = PHYS_NEXT(target);
+
+  // keep up to max_size, release the rest.
+  if (BLOCK_SIZE(target) > alloc_size) {
+    FREE_BLOCK *release = split_block(pool, target, alloc_size);
+    if (release != NULL) {
+      SET_PREV_USED(release);
+      add_free_block(pool, release);
+      goto DONE;
     }
-    est_free(est, ptr);
-    return new_ptr;
   }
+  SET_PREV_USED(next);
+
+ DONE:
+  SET_REQUESTED(target, BLOCK_SIZE(target) - sizeof(USED_BLOCK));
+  PROFILE();
+  return BLOCK_SIZE(target) - sizeof(USED_BLOCK);
+
+ NO_MERGE:
+  if (BLOCK_SIZE(target) - sizeof(USED_BLOCK) >= min_size) {
+    return BLOCK_SIZE(target) - sizeof(USED_BLOCK);
+  }
+  return 0;
+}
+
+
+//================================================================
+/*! copy the contents to other memory, and release the block
+
+  The destination can be in another pool. (e.g. the fallback of
+  est_tier_realloc() and est_subpool_realloc())
+
+  @param  est      Pointer to ESTALLOC that owns ptr.
+  @param  ptr      Return value of est_malloc()
+  @param  new_ptr  destination memory.
+  @param  size     size of new_ptr. the contents are copied up to it.
+  @return void *   new_ptr.
+*/
+void *
+est_move(ESTALLOC *est, void *ptr, void *new_ptr, unsigned int size)
+{
+  unsigned int len = est_usable_size(est, ptr);
+  if (len > size) len = size;
+
+  for (unsigned int i = 0; i < len; i++) {
+    ((uint8_t *)new_ptr)[i] = ((uint8_t *)ptr)[i];
+  }
+  est_free(est, ptr);
+  return new_ptr;
 }
 
 
@@ -847,6 +1835,253 @@ est_usable_size(ESTALLOC *est, void *ptr)
 }
 
 
+//================================================================
+/*! offset of the memory from the pool
+
+  The offset is valid wherever the pool is mapped.
+  (e.g. shared memory mapped by processes)
+
+  @param  est     Pointer to ESTALLOC.
+  @param  ptr     Return value of est_malloc()
+  @retval unsigned int  offset.
+  @retval 0       ptr is NULL.
+*/
+unsigned int
+est_ptr_to_off(ESTALLOC *est, const void *ptr)
+{
+  if (ptr == NULL) return 0;
+  return (unsigned int)((const uint8_t *)ptr - (uint8_t *)est);
+}
+
+
+//================================================================
+/*! memory at the offset from the pool
+
+  @param  est     Pointer to ESTALLOC.
+  @param  off     Return value of est_ptr_to_off()
+  @return void *  pointer to allocated memory.
+  @retval NULL    off is 0.
+*/
+void *
+est_off_to_ptr(ESTALLOC *est, unsigned int off)
+{
+  if (off == 0) return NULL;
+  return (uint8_t *)est + off;
+}
+
+
+#if defined(ESTALLOC_BLOCK_INDEX)
+//================================================================
+/*! find the block that contains the address (interior pointer lookup)
+
+  Blocks allocated by est_permalloc() are not managed one by one,
+  so an address in them is reported as not found.
+
+  @param  est   Pointer to ESTALLOC.
+  @param  adrs  any address.
+  @param  used  (out) 1 if the block is in use, 0 if free. (nullable)
+  @return void * pointer to the block, same as the return value of est_malloc().
+  @retval NULL  adrs is not in any block.
+*/
+void *
+est_block_of(ESTALLOC *est, const void *adrs, int *used)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+  USED_BLOCK *block;
+
+  if ((const uint8_t *)adrs < (uint8_t *)BPOOL_TOP(pool) ||
+      (const uint8_t *)adrs >= (uint8_t *)BPOOL_END(pool)) return NULL;
+
+  if (pool->block_index[0]) {
+    int32_t bit = index_prev(pool, INDEX_BIT(pool, adrs));
+    if (bit < 0) return NULL;
+    block = (USED_BLOCK *)((uint8_t *)BPOOL_TOP(pool) + (uint32_t)bit * ESTALLOC_ALIGNMENT);
+  } else {
+    block = BPOOL_TOP(pool);
+    while ((uint8_t *)PHYS_NEXT(block) <= (const uint8_t *)adrs) {
+      block = PHYS_NEXT(block);
+    }
+  }
+
+  // tail block is the sentinel and permalloc area.
+  if (PHYS_NEXT(block) >= BPOOL_END(pool)) return NULL;
+
+  if (used) *used = IS_USED_BLOCK(block) ? 1 : 0;
+  return (uint8_t *)block + sizeof(USED_BLOCK);
+}
+#endif
+
+
+#if defined(ESTALLOC_ISR_RESERVE)
+//================================================================
+/*! add n to the counter atomically
+
+  @param  p  pointer to counter.
+  @param  n  value to add. (may be negative)
+*/
+static inline void
+isr_count_add(uint32_t *p, int n)
+{
+  uint32_t count = ESTALLOC_ISR_LOAD(p);
+  while (!ESTALLOC_ISR_CAS(p, &count, count + n)) {
+  }
+}
+
+
+//================================================================
+/*! fill the reserve for interrupt context. (call from normal context)
+
+  The reserve is a lock-free stack of preallocated blocks.
+  The block size is fixed by the first call.
+
+  @param  est    Pointer to ESTALLOC.
+  @param  count  number of blocks to be kept in the reserve.
+  @param  size   request size of a block.
+  @retval 0      success.
+  @retval -1     size mismatch or out of memory.
+*/
+int
+est_isr_reserve(ESTALLOC *est, unsigned int count, unsigned int size)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+
+#if !defined(ESTALLOC_ADDRESS_16BIT)
+  if (pool->size / ESTALLOC_ALIGNMENT > ISR_LINK_MASK) return -1;
+#endif
+  if (pool->isr_size == 0) {
+    pool->isr_size = size < sizeof(uint32_t) ? sizeof(uint32_t) : size;
+  }
+  if (size > pool->isr_size) return -1;
+
+  while (ESTALLOC_ISR_LOAD(&pool->isr_count) < count) {
+    void *ptr = est_malloc(est, pool->isr_size);
+    if (ptr == NULL) return -1;
+    est_free_isr(est, ptr);
+  }
+
+  return 0;
+}
+
+
+//================================================================
+/*! allocate memory from the reserve. (callable from interrupt context)
+
+  It never touches the TLSF index, so it is safe even if est_malloc()
+  or est_free() is interrupted. A tag in the stack top prevents the
+  ABA problem unless the same block is popped 256 times during one pop.
+
+  @param  est   Pointer to ESTALLOC.
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  reserve is empty, or size is larger than the reserved size.
+*/
+void *
+est_malloc_isr(ESTALLOC *est, unsigned int size)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+  if (size > pool->isr_size) return NULL;
+
+  uint32_t head = ESTALLOC_ISR_LOAD(&pool->isr_head);
+  uint32_t next;
+  do {
+    if ((head & ISR_LINK_MASK) == 0) return NULL;
+    next = (*ISR_PTR(pool, head) & ISR_LINK_MASK) | ((head + ISR_TAG_ONE) & ~ISR_LINK_MASK);
+  } while (!ESTALLOC_ISR_CAS(&pool->isr_head, &head, next));
+
+  isr_count_add(&pool->isr_count, -1);
+
+  return ISR_PTR(pool, head);
+}
+
+
+//================================================================
+/*! return memory to the reserve. (callable from interrupt context)
+
+  Blocks allocated by est_malloc_isr() can also be released by est_free()
+  from normal context. Then est_isr_reserve() refills the reserve.
+
+  @param  est  Pointer to ESTALLOC.
+  @param  ptr  Return value of est_malloc_isr()
+*/
+void
+est_free_isr(ESTALLOC *est, void *ptr)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+
+  if (ptr == NULL) return;
+#if defined(ESTALLOC_DEBUG)
+  if (BLOCK_SIZE((USED_BLOCK *)BLOCK_ADRS(ptr)) - sizeof(USED_BLOCK) < pool->isr_size) {
+    est->error_message = "est_free_isr(): too small block was specified.\n";
+    return;
+  }
+#endif
+
+  uint32_t *link = ptr;
+  uint32_t head = ESTALLOC_ISR_LOAD(&pool->isr_head);
+  uint32_t top;
+  do {
+    *link = head & ISR_LINK_MASK;
+    top = ISR_LINK(pool, ptr) | ((head + ISR_TAG_ONE) & ~ISR_LINK_MASK);
+  } while (!ESTALLOC_ISR_CAS(&pool->isr_head, &head, top));
+
+  isr_count_add(&pool->isr_count, 1);
+}
+#endif // ESTALLOC_ISR_RESERVE
+
+
+#if defined(ESTALLOC_REFCOUNT)
+//================================================================
+/*! allocate memory with a reference count of 1
+
+  @param  est   Pointer to ESTALLOC.
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+void *
+est_malloc_rc(ESTALLOC *est, unsigned int size)
+{
+  uint8_t *block = est_malloc(est, size + RC_HEADER_SIZE);
+  if (block == NULL) return NULL;
+
+  *(uint32_t *)block = 1;
+  return block + RC_HEADER_SIZE;
+}
+
+
+//================================================================
+/*! add a reference (callable from any thread)
+
+  @param  ptr  Return value of est_malloc_rc()
+*/
+void
+est_retain(void *ptr)
+{
+  ESTALLOC_RC_ADD(RC_COUNT(ptr), 1);
+}
+
+
+//================================================================
+/*! drop a reference, and free the memory by the last one
+
+  @param  est  Pointer to ESTALLOC.
+  @param  ptr  Return value of est_malloc_rc()
+  @retval unsigned int  remaining references. (0: released)
+*/
+unsigned int
+est_release(ESTALLOC *est, void *ptr)
+{
+  if (ptr == NULL) return 0;
+
+  uint32_t count = ESTALLOC_RC_ADD(RC_COUNT(ptr), -1);
+  if (count == 0) {
+    ESTALLOC_RC_FREE(est, RC_COUNT(ptr));
+  }
+  return count;
+}
+#endif // ESTALLOC_REFCOUNT
+
+
 #if defined(ESTALLOC_DEBUG)
 //================================================================
 /*! statistics
@@ -880,6 +2115,87 @@ est_take_statistics(ESTALLOC *est)
 }
 
 
+//================================================================
+/*! statistics of free blocks
+
+  @param  est     Pointer to ESTALLOC.
+  @param  fstat   (out) largest free block and number of free blocks.
+*/
+void
+est_take_free_statistics(ESTALLOC *est, ESTALLOC_FREE_STAT *fstat)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+
+  fstat->largest = 0;
+  fstat->count = 0;
+
+  for (int i = 0; i <= SIZE_FREE_BLOCKS; i++) {
+    FREE_BLOCK *block;
+    for (block = FREE_LIST(pool, i); block; block = NEXT_FREE(pool, block)) {
+      if (fstat->largest < BLOCK_SIZE(block)) fstat->largest = BLOCK_SIZE(block);
+      fstat->count++;
+    }
+  }
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+  if (pool->victim) {
+    if (fstat->largest < BLOCK_SIZE(VICTIM(pool))) fstat->largest = BLOCK_SIZE(VICTIM(pool));
+    fstat->count++;
+  }
+#endif
+}
+
+
+//================================================================
+/*! breakdown of the pool into payload and overhead
+
+  Without ESTALLOC_TRACK_REQUESTED_SIZE, the requested size is unknown,
+  so round-up slack is counted in requested.
+
+  @param  est         Pointer to ESTALLOC.
+  @param  ovh         (out) breakdown. the members sum up to the pool size.
+  @param  min_useful  free blocks with smaller usable size are unusable.
+*/
+void
+est_take_overhead(ESTALLOC *est, ESTALLOC_OVERHEAD *ovh, unsigned int min_useful)
+{
+  MEMORY_POOL *pool = (MEMORY_POOL *)est;
+  USED_BLOCK *block = BPOOL_TOP(pool);
+  ESTALLOC_MEMSIZE_T sentinel_size = sizeof(USED_BLOCK);
+  sentinel_size += (-sentinel_size & ALIGNMENT_MASK);
+
+  ESTALLOC_OVERHEAD zero_ovh = {0};
+  *ovh = zero_ovh;
+  ovh->pool_header = sizeof(MEMORY_POOL);
+
+  while (block < (USED_BLOCK *)BPOOL_END(pool)) {
+    ESTALLOC_MEMSIZE_T usable = BLOCK_SIZE(block) - sizeof(USED_BLOCK);
+
+    if (PHYS_NEXT(block) >= BPOOL_END(pool)) {
+      // tail block. sentinel and permalloc area.
+      ovh->sentinel = sentinel_size;
+      ovh->permalloc = BLOCK_SIZE(block) - sentinel_size;
+    } else if (IS_FREE_BLOCK(block)) {
+      ovh->free_blocks++;
+      if (usable < min_useful) {
+        ovh->unusable_free += BLOCK_SIZE(block);
+      } else {
+        ovh->free += BLOCK_SIZE(block);
+      }
+    } else {
+      ovh->used_blocks++;
+      ovh->block_headers += sizeof(USED_BLOCK);
+#if defined(ESTALLOC_TRACK_REQUESTED_SIZE)
+      ovh->slack += block->slack;
+      ovh->requested += usable - block->slack;
+#else
+      ovh->requested += usable;
+#endif
+    }
+    block = PHYS_NEXT(block);
+  }
+}
+
+
 //================================================================
 /*! Record current memory usage for profiling
 
@@ -949,6 +2265,7 @@ est_stop_profiling(ESTALLOC *est)
  *                - 0x04: Invalid next block address (out of bounds or overlapping)
  *                - 0x08: Previous block is used but current block says it's free
  *                - 0x10: Previous block is free but current block says it's used
+ *                - 0x20: Block index inconsistency (ESTALLOC_BLOCK_INDEX)
  */
 int
 est_sanity_check(ESTALLOC *est)
@@ -995,6 +2312,16 @@ est_sanity_check(ESTALLOC *est)
       }
     }
 
+#if defined(ESTALLOC_BLOCK_INDEX)
+    // Check the block index points to this block, over the whole block
+    if (pool->block_index[0] && block < next) {
+      if (index_prev(pool, INDEX_BIT(pool, block)) != (int32_t)INDEX_BIT(pool, block) ||
+          index_prev(pool, INDEX_BIT(pool, next) - 1) != (int32_t)INDEX_BIT(pool, block)) {
+        errors |= 0x20;
+      }
+    }
+#endif
+
     // Move to next block
     prev_block = block;
     block = next;
@@ -1030,20 +2357,36 @@ est_fprint_pool_header(ESTALLOC *est, FILE *fp)
   fprintf(fp, "    FLI :S[0123 4567] -- free_blocks ");
   for (unsigned int i = 0; i < 64; i++) { fprintf(fp, "-"); }
   fprintf(fp, "\n");
+#if defined(ESTALLOC_FLAT_BITMAP)
+  for (unsigned int i = 0; i < ESTALLOC_FLI_BIT_WIDTH +1; i++) {
+    uint8_t sli_bitmap = 0;
+    for (int j = 0; j < 8; j++) {
+      unsigned int idx = i * 8 + j;
+      if (pool->free_bitmap[idx / BITMAP_WORD_BITS] & (MSB_BIT1_WORD >> (idx % BITMAP_WORD_BITS))) {
+        sli_bitmap |= (MSB_BIT1_SLI >> j);
+      }
+    }
+    fprintf(fp, " [%2d] %d :  ", i, sli_bitmap != 0);
+#else
   for (unsigned int i = 0; i < sizeof(pool->free_sli_bitmap); i++) {
+    uint8_t sli_bitmap = pool->free_sli_bitmap[i];
     fprintf(fp, " [%2d] %d :  ", i, !!((pool->free_fli_bitmap << i) & MSB_BIT1_FLI));
+#endif
     for (int j = 0; j < 8; j++) {
-      fprintf(fp, "%d", !!((pool->free_sli_bitmap[i] << j) & MSB_BIT1_SLI));
+      fprintf(fp, "%d", !!((sli_bitmap << j) & MSB_BIT1_SLI));
       if ((j % 4) == 3 ) fprintf(fp, " ");
     }
 
     for (int j = 0; j < 8; j++) {
       unsigned int idx = i * 8 + j;
-      if (idx >= sizeof(pool->free_blocks) / sizeof(FREE_BLOCK *) ) break;
-      fprintf(fp, " %p", pool->free_blocks[idx]);
+      if (idx >= sizeof(pool->free_blocks) / sizeof(BLOCK_LINK) ) break;
+      fprintf(fp, " %p", (void *)FREE_LIST(pool, idx));
     }
     fprintf(fp,  "\n");
   }
+#if defined(ESTALLOC_DESIGNATED_VICTIM)
+  fprintf(fp, " victim: %p\n", (void *)VICTIM(pool));
+#endif
 }
 
 //================================================================
@@ -1091,7 +2434,7 @@ est_fprint_memory_block(ESTALLOC *est, FILE *fp)
       /* Free block */
       unsigned int index = calc_index(BLOCK_SIZE(block));
       fprintf(fp, " fli:%d sli:%d pf:%p nf:%p",
-      FLI(index), SLI(index), block->prev_free, block->next_free);
+      FLI(index), SLI(index), (void *)PREV_FREE(pool, block), (void *)NEXT_FREE(pool, block));
     }
 
     fprintf(fp, "\n");
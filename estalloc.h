@@ -18,6 +18,7 @@
 #define ESTALLOC_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -29,8 +30,9 @@ extern "C" {
 # define PLATFORM_64BIT
 #endif
 
-#if defined(ESTALLOC_ADDRESS_16BIT) && defined(PLATFORM_64BIT)
-# error "ESTALLOC_ADDRESS_16BIT is not compatible with 64-bit architecture."
+// pools under 64KB on 64-bit machines keep 16-bit offsets instead of pointers.
+#if defined(ESTALLOC_ADDRESS_16BIT) && defined(PLATFORM_64BIT) && !defined(ESTALLOC_OFFSET_LINK)
+# define ESTALLOC_OFFSET_LINK
 #endif
 #if !defined(ESTALLOC_ADDRESS_16BIT) && !defined(ESTALLOC_ADDRESS_24BIT)
 # define ESTALLOC_ADDRESS_24BIT
@@ -62,6 +64,32 @@ typedef struct ESTALLOC_STAT {
   ESTALLOC_MEMSIZE_T frag;    // memory fragmentation count
 } ESTALLOC_STAT;
 
+/*!@brief
+  Structure for est_take_free_statistics function.
+  If you use this, define ESTALLOC_DEBUG pre-processor macro.
+*/
+typedef struct ESTALLOC_FREE_STAT {
+  ESTALLOC_MEMSIZE_T largest; // largest free block
+  ESTALLOC_MEMSIZE_T count;   // number of free blocks
+} ESTALLOC_FREE_STAT;
+
+/*!@brief
+  Structure for est_take_overhead function.
+  If you use this, define ESTALLOC_DEBUG pre-processor macro.
+*/
+typedef struct ESTALLOC_OVERHEAD {
+  ESTALLOC_MEMSIZE_T pool_header;     // MEMORY_POOL header
+  ESTALLOC_MEMSIZE_T block_headers;   // USED_BLOCK headers of used blocks
+  ESTALLOC_MEMSIZE_T requested;       // requested sizes of used blocks
+  ESTALLOC_MEMSIZE_T slack;           // alignment and round-up slack
+  ESTALLOC_MEMSIZE_T free;            // free blocks
+  ESTALLOC_MEMSIZE_T unusable_free;   // free blocks smaller than min_useful
+  ESTALLOC_MEMSIZE_T permalloc;       // est_permalloc() area
+  ESTALLOC_MEMSIZE_T sentinel;        // sentinel block
+  ESTALLOC_MEMSIZE_T used_blocks;     // number of used blocks
+  ESTALLOC_MEMSIZE_T free_blocks;     // number of free blocks
+} ESTALLOC_OVERHEAD;
+
 #if defined(ESTALLOC_DEBUG)
 /*!@brief
   Structure for est_start_profiling and est_stop_profiling functions.
@@ -93,19 +121,60 @@ typedef struct ESTALLOC {
 } ESTALLOC;
 #endif
 
+/*!@brief
+  Segment for est_malloc_sg function. Same layout as struct iovec.
+*/
+typedef struct ESTALLOC_IOVEC {
+  void *iov_base;
+  size_t iov_len;
+} ESTALLOC_IOVEC;
+
+// lifetime hints for est_malloc_hint()
+#define EST_HINT_SHORT_LIVED  0x01
+#define EST_HINT_LONG_LIVED   0x02
+
 ESTALLOC *est_init(void *ptr, unsigned int size);
 void est_cleanup(ESTALLOC *est);
+unsigned int est_min_pool_size(void);
 
 void *est_permalloc(ESTALLOC *est, unsigned int size);
 void *est_malloc(ESTALLOC *est, unsigned int size);
+void *est_malloc_sized(ESTALLOC *est, unsigned int size, unsigned int *usable);
+void *est_malloc_hint(ESTALLOC *est, unsigned int size, int hint);
+unsigned int est_malloc_sg(ESTALLOC *est, unsigned int total, unsigned int max_segments, ESTALLOC_IOVEC iov[]);
+void est_free_sg(ESTALLOC *est, unsigned int num_segments, ESTALLOC_IOVEC iov[]);
+unsigned int est_good_size(unsigned int size);
 void *est_realloc(ESTALLOC *est, void *ptr, unsigned int size);
 void *est_calloc(ESTALLOC *est, unsigned int nmemb, unsigned int size);
+void *est_memalign(ESTALLOC *est, unsigned int alignment, unsigned int size);
 void est_free(ESTALLOC *est, void *ptr);
 unsigned int est_usable_size(ESTALLOC *est, void *ptr);
+unsigned int est_ptr_to_off(ESTALLOC *est, const void *ptr);
+void *est_off_to_ptr(ESTALLOC *est, unsigned int off);
+unsigned int est_try_expand(ESTALLOC *est, void *ptr, unsigned int min_size, unsigned int max_size);
+void *est_move(ESTALLOC *est, void *ptr, void *new_ptr, unsigned int size);
 
 void est_take_statistics(ESTALLOC *est);
 
+#if defined(ESTALLOC_BLOCK_INDEX)
+void *est_block_of(ESTALLOC *est, const void *adrs, int *used);
+#endif
+
+#if defined(ESTALLOC_ISR_RESERVE)
+int est_isr_reserve(ESTALLOC *est, unsigned int count, unsigned int size);
+void *est_malloc_isr(ESTALLOC *est, unsigned int size);
+void est_free_isr(ESTALLOC *est, void *ptr);
+#endif
+
+#if defined(ESTALLOC_REFCOUNT)
+void *est_malloc_rc(ESTALLOC *est, unsigned int size);
+void est_retain(void *ptr);
+unsigned int est_release(ESTALLOC *est, void *ptr);
+#endif
+
 #if defined(ESTALLOC_DEBUG)
+void est_take_free_statistics(ESTALLOC *est, ESTALLOC_FREE_STAT *fstat);
+void est_take_overhead(ESTALLOC *est, ESTALLOC_OVERHEAD *ovh, unsigned int min_useful);
 int est_sanity_check(ESTALLOC *est);
 void est_start_profiling(ESTALLOC *est);
 void est_stop_profiling(ESTALLOC *est);
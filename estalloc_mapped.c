@@ -0,0 +1,178 @@
+/*! @file
+  @brief
+  mmap()-backed memory pool creation helper of ESTALLOC for Linux.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  STRATEGY
+   The pool is an anonymous mmap() region, backed by
+     EST_MAP_HUGETLB : explicit huge pages. falls back to THP if no
+                       huge page is reserved.
+     EST_MAP_THP     : transparent huge pages via madvise(MADV_HUGEPAGE).
+   With EST_MAP_PREFAULT, every page is faulted in before est_init(),
+   by N threads in parallel (EST_MAP_PREFAULT_THREADS(n)), so that the
+   first requests do not pay for page faults.
+
+  MAPPED REGION
+     | MAPPED_HEADER | Memory pool (ESTALLOC) ...                     |
+     +---------------+------------------------------------------------+
+     | length        | see estalloc.c                                 |
+  </pre>
+*/
+
+/***** Feature test switches ************************************************/
+#define _GNU_SOURCE
+
+/***** System headers *******************************************************/
+//@cond
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+//@endcond
+
+/***** Local headers ********************************************************/
+#include "estalloc_mapped.h"
+
+/***** Constant values ******************************************************/
+#if !defined(ESTALLOC_HUGE_PAGE_SIZE)
+# define ESTALLOC_HUGE_PAGE_SIZE (2u * 1024 * 1024)
+#endif
+#define MAX_PREFAULT_THREADS 64
+
+
+/***** Typedefs *************************************************************/
+typedef struct MAPPED_HEADER {
+  size_t length;        //!< mapped length.
+  size_t pad;           // keep the pool aligned.
+} MAPPED_HEADER;
+
+typedef struct PREFAULT_RANGE {
+  volatile uint8_t *top;
+  size_t length;
+  size_t step;
+} PREFAULT_RANGE;
+
+
+/***** Local functions ******************************************************/
+//================================================================
+/*! touch every page in the range
+
+  @param  arg  Pointer to PREFAULT_RANGE.
+*/
+static void *
+prefault(void *arg)
+{
+  PREFAULT_RANGE *range = arg;
+  for (size_t i = 0; i < range->length; i += range->step) {
+    range->top[i] = 0;
+  }
+  return NULL;
+}
+
+
+//================================================================
+/*! touch every page with n threads
+
+  @param  top      mapped address.
+  @param  length   mapped length.
+  @param  step     page size.
+  @param  threads  number of threads.
+*/
+static void
+prefault_parallel(uint8_t *top, size_t length, size_t step, unsigned int threads)
+{
+  pthread_t tid[MAX_PREFAULT_THREADS];
+  uint8_t started[MAX_PREFAULT_THREADS];
+  PREFAULT_RANGE range[MAX_PREFAULT_THREADS];
+  size_t pages = length / step;
+
+  if (threads == 0) threads = 1;
+  if (threads > MAX_PREFAULT_THREADS) threads = MAX_PREFAULT_THREADS;
+  if (threads > pages) threads = pages;
+
+  for (unsigned int i = 0; i < threads; i++) {
+    size_t first = pages * i / threads;
+    size_t last = pages * (i + 1) / threads;
+    range[i].top = top + first * step;
+    range[i].length = (last - first) * step;
+    range[i].step = step;
+    started[i] = (i != 0 && pthread_create(&tid[i], NULL, prefault, &range[i]) == 0);
+  }
+
+  // the calling thread does its own range, and the failed ones.
+  for (unsigned int i = 0; i < threads; i++) {
+    if (!started[i]) prefault(&range[i]);
+  }
+  for (unsigned int i = 0; i < threads; i++) {
+    if (started[i]) pthread_join(tid[i], NULL);
+  }
+}
+
+
+/***** Global functions *****************************************************/
+//================================================================
+/*! map memory and initialize a memory pool on it
+
+  @param  size   pool size.
+  @param  flags  EST_MAP_* flags.
+  @return ESTALLOC *  pointer to memory pool.
+  @retval NULL  error.
+*/
+ESTALLOC *
+est_create_mapped(unsigned int size, unsigned int flags)
+{
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t length = sizeof(MAPPED_HEADER) + size;
+  void *top = MAP_FAILED;
+
+  if (flags & EST_MAP_HUGETLB) {
+    size_t huge_length = (length + ESTALLOC_HUGE_PAGE_SIZE - 1) & ~(size_t)(ESTALLOC_HUGE_PAGE_SIZE - 1);
+    top = mmap(NULL, huge_length, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (top != MAP_FAILED) {
+      length = huge_length;
+      page_size = ESTALLOC_HUGE_PAGE_SIZE;
+    } else {
+      flags |= EST_MAP_THP;  // no huge page is reserved.
+    }
+  }
+  if (top == MAP_FAILED) {
+    length = (length + page_size - 1) & ~(page_size - 1);
+    top = mmap(NULL, length, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (top == MAP_FAILED) return NULL;
+#if defined(MADV_HUGEPAGE)
+    if (flags & EST_MAP_THP) madvise(top, length, MADV_HUGEPAGE);
+#endif
+  }
+
+  if (flags & EST_MAP_PREFAULT) {
+    prefault_parallel(top, length, page_size, (flags >> 8) & 0xff);
+  }
+
+  MAPPED_HEADER *header = top;
+  header->length = length;
+
+  return est_init((uint8_t *)top + sizeof(MAPPED_HEADER), size);
+}
+
+
+//================================================================
+/*! unmap the memory pool created by est_create_mapped()
+
+  @param  est  Pointer to ESTALLOC.
+*/
+void
+est_destroy_mapped(ESTALLOC *est)
+{
+  if (est == NULL) return;
+
+  MAPPED_HEADER *header = (MAPPED_HEADER *)((uint8_t *)est - sizeof(MAPPED_HEADER));
+  munmap(header, header->length);
+}
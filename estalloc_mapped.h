@@ -0,0 +1,37 @@
+/*! @file
+  @brief
+  mmap()-backed memory pool creation helper of ESTALLOC for Linux.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef ESTALLOC_MAPPED_H_
+#define ESTALLOC_MAPPED_H_
+
+#include "estalloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!@brief
+  Flags for est_create_mapped function.
+*/
+#define EST_MAP_HUGETLB   0x01  // explicit huge pages (MAP_HUGETLB)
+#define EST_MAP_THP       0x02  // transparent huge pages (madvise)
+#define EST_MAP_PREFAULT  0x04  // fault in all pages before est_init()
+#define EST_MAP_PREFAULT_THREADS(n)  (EST_MAP_PREFAULT | (((n) & 0xff) << 8))
+
+ESTALLOC *est_create_mapped(unsigned int size, unsigned int flags);
+void est_destroy_mapped(ESTALLOC *est);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,339 @@
+/*! @file
+  @brief
+  NUMA-aware front end of ESTALLOC for Linux.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  STRATEGY
+   One memory pool per online NUMA node. Each pool is an anonymous
+   mmap() region bound to its node by mbind(MPOL_BIND) before the
+   first touch, so every page of the pool is faulted in on that node.
+   est_numa_malloc() allocates from the pool of the node the calling
+   thread is running on (getcpu), and falls back to the other nodes
+   when the local pool is exhausted. est_numa_free() returns the block
+   to the owning pool, which is found by address.
+
+   Only raw system calls are used. No libnuma is needed.
+   If mbind() is not permitted (e.g. in a container), the pools are
+   created unbound and still work as plain per-node pools.
+  </pre>
+*/
+
+/***** Feature test switches ************************************************/
+#define _GNU_SOURCE
+
+/***** System headers *******************************************************/
+//@cond
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+//@endcond
+
+/***** Local headers ********************************************************/
+#include "estalloc_numa.h"
+
+/***** Constant values ******************************************************/
+#if !defined(MPOL_BIND)
+# define MPOL_BIND 2
+#endif
+#define NODEMASK_BITS (sizeof(unsigned long) * 8)
+#define NODEMASK_LEN  ((ESTALLOC_NUMA_MAX_NODES + NODEMASK_BITS - 1) / NODEMASK_BITS)
+
+
+/***** Typedefs *************************************************************/
+typedef struct NUMA_POOL {
+  pthread_mutex_t lock;
+  uint8_t *top;           //!< mmap()ed address, also the ESTALLOC *.
+  uint8_t *end;
+  int node;
+  uint8_t bound;          //!< mbind() succeeded.
+} NUMA_POOL;
+
+struct ESTALLOC_NUMA {
+  unsigned int num_pools;
+  unsigned int pool_size;
+  int16_t pool_of_node[ESTALLOC_NUMA_MAX_NODES];  //!< node -> pools index
+  NUMA_POOL pools[ESTALLOC_NUMA_MAX_NODES];
+};
+
+
+/***** Local functions ******************************************************/
+//================================================================
+/*! read online node list from sysfs. (e.g. "0-1,3")
+
+  @param  nodes  (out) node numbers.
+  @retval int  number of nodes.
+*/
+static int
+read_online_nodes(int *nodes)
+{
+  char buf[256];
+  int n = 0;
+
+  int fd = open("/sys/devices/system/node/online", O_RDONLY);
+  if (fd < 0) goto SINGLE_NODE;
+  ssize_t len = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  if (len <= 0) goto SINGLE_NODE;
+  buf[len] = 0;
+
+  char *p = buf;
+  while ('0' <= *p && *p <= '9') {
+    int from = 0, to;
+    while ('0' <= *p && *p <= '9') from = from * 10 + (*p++ - '0');
+    to = from;
+    if (*p == '-') {
+      p++;
+      to = 0;
+      while ('0' <= *p && *p <= '9') to = to * 10 + (*p++ - '0');
+    }
+    for (int i = from; i <= to && i < ESTALLOC_NUMA_MAX_NODES; i++) {
+      nodes[n++] = i;
+    }
+    if (*p == ',') p++;
+  }
+  if (n > 0) return n;
+
+ SINGLE_NODE:
+  nodes[0] = 0;
+  return 1;
+}
+
+
+//================================================================
+/*! node of the calling thread
+
+  @retval int  node number.
+*/
+static int
+current_node(void)
+{
+  unsigned int cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) return 0;
+  return (int)node;
+}
+
+
+//================================================================
+/*! find the pool that owns ptr
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+  @param  ptr   allocated memory.
+  @return NUMA_POOL *  owner.
+  @retval NULL  not allocated by this numa.
+*/
+static NUMA_POOL *
+find_pool(ESTALLOC_NUMA *numa, void *ptr)
+{
+  uint8_t *p = ptr;
+  for (unsigned int i = 0; i < numa->num_pools; i++) {
+    if (numa->pools[i].top < p && p < numa->pools[i].end) {
+      return &numa->pools[i];
+    }
+  }
+  return NULL;
+}
+
+
+//================================================================
+/*! allocate from the pool with lock
+
+  @param  pool  target pool.
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+static void *
+pool_malloc(NUMA_POOL *pool, unsigned int size)
+{
+  pthread_mutex_lock(&pool->lock);
+  void *ptr = est_malloc((ESTALLOC *)pool->top, size);
+  pthread_mutex_unlock(&pool->lock);
+  return ptr;
+}
+
+
+/***** Global functions *****************************************************/
+//================================================================
+/*! create one memory pool per online NUMA node
+
+  @param  size_per_node  size of each pool.
+  @return ESTALLOC_NUMA *  pointer to NUMA front end.
+  @retval NULL  error.
+*/
+ESTALLOC_NUMA *
+est_numa_create(unsigned int size_per_node)
+{
+  int nodes[ESTALLOC_NUMA_MAX_NODES];
+  int num_nodes = read_online_nodes(nodes);
+
+  ESTALLOC_NUMA *numa = mmap(NULL, sizeof(ESTALLOC_NUMA), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (numa == MAP_FAILED) return NULL;
+  numa->pool_size = size_per_node;
+  for (int i = 0; i < ESTALLOC_NUMA_MAX_NODES; i++) {
+    numa->pool_of_node[i] = -1;
+  }
+
+  for (int i = 0; i < num_nodes; i++) {
+    NUMA_POOL *pool = &numa->pools[numa->num_pools];
+    void *top = mmap(NULL, size_per_node, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (top == MAP_FAILED) {
+      est_numa_destroy(numa);
+      return NULL;
+    }
+
+    // bind before the first touch by est_init().
+    unsigned long nodemask[NODEMASK_LEN] = {0};
+    nodemask[nodes[i] / NODEMASK_BITS] |= 1UL << (nodes[i] % NODEMASK_BITS);
+    pool->bound = syscall(SYS_mbind, top, (unsigned long)size_per_node, MPOL_BIND,
+                          nodemask, (unsigned long)ESTALLOC_NUMA_MAX_NODES + 1, 0) == 0;
+
+    pool->top = top;
+    pool->end = (uint8_t *)top + size_per_node;
+    pool->node = nodes[i];
+    pthread_mutex_init(&pool->lock, NULL);
+    est_init(top, size_per_node);
+
+    numa->pool_of_node[nodes[i]] = numa->num_pools++;
+  }
+
+  return numa;
+}
+
+
+//================================================================
+/*! unmap all pools
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+*/
+void
+est_numa_destroy(ESTALLOC_NUMA *numa)
+{
+  if (numa == NULL) return;
+
+  for (unsigned int i = 0; i < numa->num_pools; i++) {
+    pthread_mutex_destroy(&numa->pools[i].lock);
+    munmap(numa->pools[i].top, numa->pool_size);
+  }
+  munmap(numa, sizeof(ESTALLOC_NUMA));
+}
+
+
+//================================================================
+/*! allocate memory on the node of the calling thread
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+void *
+est_numa_malloc(ESTALLOC_NUMA *numa, unsigned int size)
+{
+  return est_numa_malloc_node(numa, current_node(), size);
+}
+
+
+//================================================================
+/*! allocate memory on the specified node, or the other nodes
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+  @param  node  preferred node.
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+void *
+est_numa_malloc_node(ESTALLOC_NUMA *numa, int node, unsigned int size)
+{
+  unsigned int first = 0;
+  if (0 <= node && node < ESTALLOC_NUMA_MAX_NODES && numa->pool_of_node[node] >= 0) {
+    first = numa->pool_of_node[node];
+  }
+
+  for (unsigned int i = 0; i < numa->num_pools; i++) {
+    NUMA_POOL *pool = &numa->pools[(first + i) % numa->num_pools];
+    void *ptr = pool_malloc(pool, size);
+    if (ptr) return ptr;
+  }
+  return NULL;
+}
+
+
+//================================================================
+/*! release memory to the owning node
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+  @param  ptr   Return value of est_numa_malloc()
+*/
+void
+est_numa_free(ESTALLOC_NUMA *numa, void *ptr)
+{
+  if (ptr == NULL) return;
+
+  NUMA_POOL *pool = find_pool(numa, ptr);
+  if (pool == NULL) return;
+
+  pthread_mutex_lock(&pool->lock);
+  est_free((ESTALLOC *)pool->top, ptr);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+
+//================================================================
+/*! number of nodes (pools)
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+  @retval unsigned int  number of nodes.
+*/
+unsigned int
+est_numa_num_nodes(ESTALLOC_NUMA *numa)
+{
+  return numa->num_pools;
+}
+
+
+//================================================================
+/*! node that owns ptr
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+  @param  ptr   Return value of est_numa_malloc()
+  @retval int   node number.
+  @retval -1    not allocated by this numa.
+*/
+int
+est_numa_node_of(ESTALLOC_NUMA *numa, void *ptr)
+{
+  NUMA_POOL *pool = find_pool(numa, ptr);
+  return pool ? pool->node : -1;
+}
+
+
+//================================================================
+/*! memory pool of the node
+
+  Use it only when no other thread accesses the pool.
+  (e.g. est_take_statistics())
+
+  @param  numa  Pointer to ESTALLOC_NUMA.
+  @param  node  node number.
+  @return ESTALLOC *  memory pool.
+  @retval NULL  no such node.
+*/
+ESTALLOC *
+est_numa_pool(ESTALLOC_NUMA *numa, int node)
+{
+  if (node < 0 || node >= ESTALLOC_NUMA_MAX_NODES) return NULL;
+  if (numa->pool_of_node[node] < 0) return NULL;
+  return (ESTALLOC *)numa->pools[numa->pool_of_node[node]].top;
+}
@@ -0,0 +1,43 @@
+/*! @file
+  @brief
+  NUMA-aware front end of ESTALLOC for Linux.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef ESTALLOC_NUMA_H_
+#define ESTALLOC_NUMA_H_
+
+#include "estalloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !defined(ESTALLOC_NUMA_MAX_NODES)
+# define ESTALLOC_NUMA_MAX_NODES 64
+#endif
+
+typedef struct ESTALLOC_NUMA ESTALLOC_NUMA;
+
+ESTALLOC_NUMA *est_numa_create(unsigned int size_per_node);
+void est_numa_destroy(ESTALLOC_NUMA *numa);
+
+void *est_numa_malloc(ESTALLOC_NUMA *numa, unsigned int size);
+void *est_numa_malloc_node(ESTALLOC_NUMA *numa, int node, unsigned int size);
+void est_numa_free(ESTALLOC_NUMA *numa, void *ptr);
+
+unsigned int est_numa_num_nodes(ESTALLOC_NUMA *numa);
+int est_numa_node_of(ESTALLOC_NUMA *numa, void *ptr);
+ESTALLOC *est_numa_pool(ESTALLOC_NUMA *numa, int node);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
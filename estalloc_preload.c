@@ -0,0 +1,429 @@
+/*! @file
+  @brief
+  LD_PRELOAD malloc interposition shim backed by ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ make libestalloc_preload.so
+    $ LD_PRELOAD=./libestalloc_preload.so your_program
+
+  STRATEGY
+   A process-wide list of arenas. Each arena is an anonymous mmap()
+   region initialized by est_init(). When all arenas are exhausted,
+   a new one is mapped (growable pool). A request larger than a half
+   of ESTALLOC_PRELOAD_ARENA_SIZE gets a dedicated arena, which is
+   unmapped again when it becomes empty.
+
+   Memory for the arenas comes directly from mmap(), so the shim never
+   calls dlsym() or the original malloc, and calls during the dynamic
+   loader's bootstrap are served like any other call.
+
+   All entry points are serialized by one process-wide mutex.
+   Returned memory is aligned to ESTALLOC_PRELOAD_MIN_ALIGNMENT, which is
+   what programs expect from the system malloc (alignof(max_align_t)).
+   Requests are rounded up so that every block is a multiple of 16
+   bytes, and the first block of an arena is placed so that its data
+   is aligned. Then est_malloc() results keep the alignment, and
+   est_memalign() is used only when one does not.
+
+   The shim is built with ESTALLOC_FLI_BIT_WIDTH=15, the widest of the
+   two-level bitmap. Then the index covers blocks up to 8MB on 64-bit
+   machines, that is the default arena size. Larger free blocks would
+   share the last bin and its first-fit walk.
+  </pre>
+*/
+
+/***** Feature test switches ************************************************/
+#define _GNU_SOURCE
+
+/***** System headers *******************************************************/
+//@cond
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+//@endcond
+
+/***** Local headers ********************************************************/
+#include "estalloc.h"
+
+/***** Constant values ******************************************************/
+#if !defined(ESTALLOC_PRELOAD_ARENA_SIZE)
+# define ESTALLOC_PRELOAD_ARENA_SIZE  (8u * 1024 * 1024)
+#endif
+#if !defined(ESTALLOC_PRELOAD_MAX_ARENAS)
+# define ESTALLOC_PRELOAD_MAX_ARENAS  1024
+#endif
+#if !defined(ESTALLOC_PRELOAD_MIN_ALIGNMENT)
+# define ESTALLOC_PRELOAD_MIN_ALIGNMENT  16
+#endif
+#define PAGE_SIZE_ROUND(x) (((x) + 4095) & ~(size_t)4095)
+
+// enough for the MEMORY_POOL header, sentinel and alignment slack.
+#define ARENA_OVERHEAD  4096
+
+// usable size of 16n+8. with 8 bytes block header, the block is 16n+16.
+#define ROUND_REQUEST(size) ((((size) + 7) & ~(size_t)15) + 8)
+
+
+/***** Typedefs *************************************************************/
+typedef struct ARENA {
+  uint8_t *top;           //!< mmap()ed address.
+  ESTALLOC *est;          //!< memory pool in the arena.
+  uint8_t *end;
+  size_t size;            //!< mapped size.
+  unsigned int live;      //!< number of live allocations.
+  uint8_t dedicated;      //!< unmap when it becomes empty.
+} ARENA;
+
+
+/***** Global variables *****************************************************/
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static ARENA arenas[ESTALLOC_PRELOAD_MAX_ARENAS];
+static unsigned int num_arenas;
+static ARENA *last_arena;
+
+
+/***** Local functions ******************************************************/
+//================================================================
+/*! map a new arena
+
+  @param  size       arena size.
+  @param  dedicated  unmap when it becomes empty.
+  @return ARENA *  new arena.
+  @retval NULL  error.
+*/
+static ARENA *
+arena_create(size_t size, uint8_t dedicated)
+{
+  if (num_arenas >= ESTALLOC_PRELOAD_MAX_ARENAS) return NULL;
+  if (size > (ESTALLOC_MEMSIZE_T)(~0)) return NULL;
+
+  void *top = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (top == MAP_FAILED) return NULL;
+
+  // the first block decides the alignment of all blocks. (see ROUND_REQUEST)
+  ESTALLOC *est = est_init(top, (unsigned int)size);
+  void *probe = est_malloc(est, ROUND_REQUEST(1));
+  if (((uintptr_t)probe & (ESTALLOC_PRELOAD_MIN_ALIGNMENT - 1)) != 0) {
+    est = est_init((uint8_t *)top + 8, (unsigned int)size - 8);
+  } else if (probe) {
+    est_free(est, probe);
+  }
+
+  ARENA *arena = &arenas[num_arenas++];
+  arena->top = top;
+  arena->est = est;
+  arena->end = (uint8_t *)top + size;
+  arena->size = size;
+  arena->live = 0;
+  arena->dedicated = dedicated;
+  return arena;
+}
+
+
+//================================================================
+/*! unmap the arena and remove it from the list
+
+  @param  arena  target arena.
+*/
+static void
+arena_destroy(ARENA *arena)
+{
+  munmap(arena->top, arena->size);
+  *arena = arenas[--num_arenas];
+  last_arena = NULL;
+}
+
+
+//================================================================
+/*! find the arena that owns ptr
+
+  @param  ptr  allocated memory.
+  @return ARENA *  owner.
+  @retval NULL  not allocated by this shim.
+*/
+static ARENA *
+arena_find(void *ptr)
+{
+  uint8_t *p = ptr;
+  if (last_arena && last_arena->top < p && p < last_arena->end) {
+    return last_arena;
+  }
+  for (unsigned int i = 0; i < num_arenas; i++) {
+    if (arenas[i].top < p && p < arenas[i].end) {
+      return last_arena = &arenas[i];
+    }
+  }
+  return NULL;
+}
+
+
+//================================================================
+/*! allocate from the arena.
+
+  est_malloc() results of rounded requests meet the minimum alignment.
+  Split off the head by est_memalign() only when one does not.
+
+  @param  arena      target arena.
+  @param  alignment  alignment.
+  @param  size       request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+static void *
+arena_alloc(ARENA *arena, size_t alignment, size_t size)
+{
+  ESTALLOC *est = arena->est;
+
+  if (alignment == ESTALLOC_PRELOAD_MIN_ALIGNMENT) {
+    void *ptr = est_malloc(est, ROUND_REQUEST(size));
+    if (ptr == NULL || ((uintptr_t)ptr & (alignment - 1)) == 0) return ptr;
+    est_free(est, ptr);
+  }
+  return est_memalign(est, alignment, size);
+}
+
+
+//================================================================
+/*! allocate from any arena, mapping a new one if needed.
+    the caller must hold arena_lock.
+
+  @param  alignment  alignment.
+  @param  size       request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+static void *
+locked_alloc(size_t alignment, size_t size)
+{
+  void *ptr;
+
+  if (alignment < ESTALLOC_PRELOAD_MIN_ALIGNMENT) {
+    alignment = ESTALLOC_PRELOAD_MIN_ALIGNMENT;
+  }
+  if (size > ESTALLOC_PRELOAD_ARENA_SIZE / 2) goto DEDICATED;
+
+  if (last_arena && !last_arena->dedicated) {
+    ptr = arena_alloc(last_arena, alignment, size);
+    if (ptr) goto FOUND;
+  }
+  for (unsigned int i = 0; i < num_arenas; i++) {
+    last_arena = &arenas[i];
+    if (last_arena->dedicated) continue;
+    ptr = arena_alloc(last_arena, alignment, size);
+    if (ptr) goto FOUND;
+  }
+
+  last_arena = arena_create(ESTALLOC_PRELOAD_ARENA_SIZE, 0);
+  if (last_arena == NULL) return NULL;
+  ptr = arena_alloc(last_arena, alignment, size);
+  if (ptr) goto FOUND;
+
+  // too large alignment for a shared arena. do not keep the empty one.
+  arena_destroy(last_arena);
+
+ DEDICATED:
+  if (size > SIZE_MAX - alignment - ARENA_OVERHEAD) return NULL;
+  last_arena = arena_create(PAGE_SIZE_ROUND(size + alignment + ARENA_OVERHEAD), 1);
+  if (last_arena == NULL) return NULL;
+  ptr = arena_alloc(last_arena, alignment, size);
+  if (ptr == NULL) {
+    arena_destroy(last_arena);
+    return NULL;
+  }
+
+ FOUND:
+  last_arena->live++;
+  return ptr;
+}
+
+
+//================================================================
+/*! release memory. the caller must hold arena_lock.
+
+  @param  arena  owner of ptr.
+  @param  ptr    allocated memory.
+*/
+static void
+locked_free(ARENA *arena, void *ptr)
+{
+  est_free(arena->est, ptr);
+  if (--arena->live == 0 && arena->dedicated) {
+    arena_destroy(arena);
+  }
+}
+
+
+//================================================================
+/*! allocate aligned memory, and set errno on error.
+
+  @param  alignment  alignment.
+  @param  size       request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+static void *
+aligned_alloc_internal(size_t alignment, size_t size)
+{
+  pthread_mutex_lock(&arena_lock);
+  void *ptr = locked_alloc(alignment, size);
+  pthread_mutex_unlock(&arena_lock);
+
+  if (ptr == NULL) errno = ENOMEM;
+  return ptr;
+}
+
+
+static void fork_prepare(void) { pthread_mutex_lock(&arena_lock); }
+static void fork_parent(void) { pthread_mutex_unlock(&arena_lock); }
+static void fork_child(void) { pthread_mutex_init(&arena_lock, NULL); }
+
+__attribute__((constructor))
+static void
+preload_init(void)
+{
+  pthread_atfork(fork_prepare, fork_parent, fork_child);
+}
+
+
+/***** Global functions *****************************************************/
+void *
+malloc(size_t size)
+{
+  return aligned_alloc_internal(0, size);
+}
+
+
+void
+free(void *ptr)
+{
+  if (ptr == NULL) return;
+
+  pthread_mutex_lock(&arena_lock);
+  ARENA *arena = arena_find(ptr);
+  if (arena) locked_free(arena, ptr);
+  pthread_mutex_unlock(&arena_lock);
+}
+
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+  if (size != 0 && nmemb > SIZE_MAX / size) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  void *ptr = aligned_alloc_internal(0, nmemb * size);
+  if (ptr) memset(ptr, 0, nmemb * size);
+  return ptr;
+}
+
+
+void *
+realloc(void *ptr, size_t size)
+{
+  if (ptr == NULL) return malloc(size);
+  if (size == 0) {
+    free(ptr);
+    return NULL;
+  }
+
+  pthread_mutex_lock(&arena_lock);
+  ARENA *arena = arena_find(ptr);
+  if (arena == NULL) {
+    pthread_mutex_unlock(&arena_lock);
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  // est_realloc() may move the block to an address that does not meet
+  // ESTALLOC_PRELOAD_MIN_ALIGNMENT. in that case, move it once more.
+  ESTALLOC *est = arena->est;
+  void *new_ptr = NULL;
+  if (size <= ESTALLOC_PRELOAD_ARENA_SIZE / 2 || size <= est_usable_size(est, ptr)) {
+    new_ptr = est_realloc(est, ptr, (unsigned int)ROUND_REQUEST(size));
+  }
+  if (new_ptr && ((uintptr_t)new_ptr & (ESTALLOC_PRELOAD_MIN_ALIGNMENT - 1)) == 0) {
+    pthread_mutex_unlock(&arena_lock);
+    return new_ptr;
+  }
+  if (new_ptr) ptr = new_ptr;
+
+  size_t old_size = est_usable_size(est, ptr);
+  new_ptr = locked_alloc(0, size);
+  if (new_ptr) {
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    locked_free(arena, ptr);
+  }
+  pthread_mutex_unlock(&arena_lock);
+
+  if (new_ptr == NULL) errno = ENOMEM;
+  return new_ptr;
+}
+
+
+int
+posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+  if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+  void *ptr = aligned_alloc_internal(alignment, size);
+  if (ptr == NULL) return ENOMEM;
+  *memptr = ptr;
+  return 0;
+}
+
+
+void *
+aligned_alloc(size_t alignment, size_t size)
+{
+  if ((alignment & (alignment - 1)) != 0) {
+    errno = EINVAL;
+    return NULL;
+  }
+  return aligned_alloc_internal(alignment, size);
+}
+
+
+void *
+memalign(size_t alignment, size_t size)
+{
+  return aligned_alloc(alignment, size);
+}
+
+
+void *
+valloc(size_t size)
+{
+  return aligned_alloc_internal(4096, size);
+}
+
+
+void *
+pvalloc(size_t size)
+{
+  return aligned_alloc_internal(4096, PAGE_SIZE_ROUND(size));
+}
+
+
+size_t
+malloc_usable_size(void *ptr)
+{
+  if (ptr == NULL) return 0;
+
+  pthread_mutex_lock(&arena_lock);
+  ARENA *arena = arena_find(ptr);
+  size_t size = arena ? est_usable_size(arena->est, ptr) : 0;
+  pthread_mutex_unlock(&arena_lock);
+  return size;
+}
@@ -0,0 +1,243 @@
+/*! @file
+  @brief
+  FIFO ring buffer sub-allocator of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  STRATEGY
+   For message queues that allocate and free strictly in FIFO order.
+   The ring is one block of the memory pool, and records of variable
+   length are placed in it one after another, each with a length
+   header of ESTALLOC_ALIGNMENT bytes. No split, merge or free list.
+
+   The producer reserves a record, writes the message and commits it.
+   The consumer peeks the oldest record and releases it. When a record
+   does not fit at the end of the ring, a wrap mark is put there and
+   the record goes to the top.
+
+   With EST_RING_SPSC, one producer thread and one consumer thread can
+   use the ring without lock. Only the producer writes tail, and only
+   the consumer writes head. (acquire/release, see ESTALLOC_RING_LOAD)
+   Since an empty ring is not rewound in this mode, a record larger
+   than half the capacity may not fit even in an empty ring.
+
+  RING BUFFER
+     | ESTALLOC_RING | len | message | len | message | WRAP |      |
+     +---------------+-----+---------+-----+---------+------+------+
+                     ^head                           ^tail
+  </pre>
+*/
+
+/***** System headers *******************************************************/
+//@cond
+#include <stddef.h>
+#include <stdint.h>
+//@endcond
+
+/***** Local headers ********************************************************/
+#include "estalloc_ring.h"
+
+/***** Constant values ******************************************************/
+#define RECORD_HEADER_SIZE  ESTALLOC_ALIGNMENT
+#define WRAP_MARK           0xffffffff
+
+/***** Macros ***************************************************************/
+#define RECORD_SIZE(n) \
+  (((n) + RECORD_HEADER_SIZE + RECORD_HEADER_SIZE - 1) & ~(uint32_t)(RECORD_HEADER_SIZE - 1))
+#define RECORD_LEN(ring, pos)  (*(uint32_t *)((ring)->buf + (pos)))
+
+/*
+  Atomic operations for EST_RING_SPSC.
+  Override them if the target lacks __atomic builtins.
+*/
+#if !defined(ESTALLOC_RING_LOAD)
+# define ESTALLOC_RING_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#endif
+#if !defined(ESTALLOC_RING_STORE)
+# define ESTALLOC_RING_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+#define RING_LOAD(ring, p) \
+  (((ring)->flags & EST_RING_SPSC) ? ESTALLOC_RING_LOAD(p) : *(p))
+#define RING_STORE(ring, p, v) do { \
+    if ((ring)->flags & EST_RING_SPSC) ESTALLOC_RING_STORE(p, v); else *(p) = (v); \
+  } while (0)
+
+
+/***** Typedefs *************************************************************/
+struct ESTALLOC_RING {
+  uint32_t head;            //!< offset of the oldest record. (consumer)
+  uint32_t tail;            //!< offset of the next record. (producer)
+  uint32_t capacity;
+  uint32_t flags;
+  uint32_t reserved_pos;    //!< offset of the reserved record.
+  uint32_t reserved_size;   //!< record size of it. 0: not reserved.
+  uint32_t wrap_pos;        //!< offset to put the wrap mark, or capacity.
+  uint32_t pad;             // keep buf aligned.
+  uint8_t buf[];
+};
+
+
+/***** Global functions *****************************************************/
+//================================================================
+/*! create a ring buffer in the memory pool
+
+  @param  est       Pointer to ESTALLOC.
+  @param  capacity  size of the ring buffer.
+  @param  flags     0 or EST_RING_SPSC.
+  @return ESTALLOC_RING *  pointer to ring buffer.
+  @retval NULL  Out of memory.
+*/
+ESTALLOC_RING *
+est_ring_create(ESTALLOC *est, unsigned int capacity, unsigned int flags)
+{
+  capacity &= ~(unsigned int)(RECORD_HEADER_SIZE - 1);
+  if (capacity < RECORD_HEADER_SIZE * 2) return NULL;
+
+  ESTALLOC_RING *ring = est_malloc(est, sizeof(ESTALLOC_RING) + capacity);
+  if (ring == NULL) return NULL;
+
+  ring->head = 0;
+  ring->tail = 0;
+  ring->capacity = capacity;
+  ring->flags = flags;
+  ring->reserved_size = 0;
+
+  return ring;
+}
+
+
+//================================================================
+/*! release the ring buffer to the memory pool
+
+  @param  est   Pointer to ESTALLOC.
+  @param  ring  Return value of est_ring_create()
+*/
+void
+est_ring_destroy(ESTALLOC *est, ESTALLOC_RING *ring)
+{
+  est_free(est, ring);
+}
+
+
+//================================================================
+/*! reserve a record (producer)
+
+  The record is not visible to the consumer until est_ring_commit().
+  A reservation replaces the previous uncommitted one.
+
+  @param  ring  Pointer to ESTALLOC_RING.
+  @param  size  message size.
+  @return void * pointer to message area.
+  @retval NULL  the ring is full.
+*/
+void *
+est_ring_reserve(ESTALLOC_RING *ring, unsigned int size)
+{
+  uint32_t capacity = ring->capacity;
+  if (size >= capacity) return NULL;
+
+  uint32_t rec = RECORD_SIZE(size);
+  uint32_t tail = ring->tail;
+  uint32_t head = RING_LOAD(ring, &ring->head);
+  uint32_t pos;
+
+  // empty. start from the top, unless the consumer is another thread.
+  if (tail == head && !(ring->flags & EST_RING_SPSC)) {
+    ring->head = ring->tail = tail = head = 0;
+  }
+
+  // tail must not reach head, which means empty.
+  if (tail >= head) {
+    if (rec < capacity - tail || (rec == capacity - tail && head > 0)) {
+      pos = tail;
+    } else if (rec < head) {
+      pos = 0;            // wrap around
+    } else {
+      return NULL;
+    }
+  } else {
+    if (rec >= head - tail) return NULL;
+    pos = tail;
+  }
+
+  ring->reserved_pos = pos;
+  ring->reserved_size = rec;
+  ring->wrap_pos = (pos == tail) ? capacity : tail;
+
+  return ring->buf + pos + RECORD_HEADER_SIZE;
+}
+
+
+//================================================================
+/*! commit the reserved record (producer)
+
+  @param  ring  Pointer to ESTALLOC_RING.
+  @param  size  message size. (up to the reserved size)
+*/
+void
+est_ring_commit(ESTALLOC_RING *ring, unsigned int size)
+{
+  if (ring->reserved_size == 0) return;
+
+  uint32_t rec = RECORD_SIZE(size);
+  if (rec > ring->reserved_size) {
+    rec = ring->reserved_size;
+    size = rec - RECORD_HEADER_SIZE;
+  }
+
+  RECORD_LEN(ring, ring->reserved_pos) = size;
+  if (ring->wrap_pos != ring->capacity) {
+    RECORD_LEN(ring, ring->wrap_pos) = WRAP_MARK;
+  }
+
+  uint32_t tail = ring->reserved_pos + rec;
+  if (tail == ring->capacity) tail = 0;
+  ring->reserved_size = 0;
+
+  RING_STORE(ring, &ring->tail, tail);
+}
+
+
+//================================================================
+/*! get the oldest record (consumer)
+
+  @param  ring  Pointer to ESTALLOC_RING.
+  @param  size  (out) message size.
+  @return void * pointer to message.
+  @retval NULL  the ring is empty.
+*/
+void *
+est_ring_peek(ESTALLOC_RING *ring, unsigned int *size)
+{
+  uint32_t head = ring->head;
+  if (head == RING_LOAD(ring, &ring->tail)) return NULL;
+
+  if (RECORD_LEN(ring, head) == WRAP_MARK) head = 0;
+  if (size) *size = RECORD_LEN(ring, head);
+
+  return ring->buf + head + RECORD_HEADER_SIZE;
+}
+
+
+//================================================================
+/*! release the oldest record (consumer)
+
+  @param  ring  Pointer to ESTALLOC_RING.
+*/
+void
+est_ring_release(ESTALLOC_RING *ring)
+{
+  uint32_t head = ring->head;
+  if (head == RING_LOAD(ring, &ring->tail)) return;
+
+  if (RECORD_LEN(ring, head) == WRAP_MARK) head = 0;
+  head += RECORD_SIZE(RECORD_LEN(ring, head));
+  if (head == ring->capacity) head = 0;
+
+  RING_STORE(ring, &ring->head, head);
+}
@@ -0,0 +1,41 @@
+/*! @file
+  @brief
+  FIFO ring buffer sub-allocator of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef ESTALLOC_RING_H_
+#define ESTALLOC_RING_H_
+
+#include "estalloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!@brief
+  Flags for est_ring_create function.
+*/
+#define EST_RING_SPSC  0x01   // single producer and single consumer threads, lock-free
+
+typedef struct ESTALLOC_RING ESTALLOC_RING;
+
+ESTALLOC_RING *est_ring_create(ESTALLOC *est, unsigned int capacity, unsigned int flags);
+void est_ring_destroy(ESTALLOC *est, ESTALLOC_RING *ring);
+
+void *est_ring_reserve(ESTALLOC_RING *ring, unsigned int size);
+void est_ring_commit(ESTALLOC_RING *ring, unsigned int size);
+void *est_ring_peek(ESTALLOC_RING *ring, unsigned int *size);
+void est_ring_release(ESTALLOC_RING *ring);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
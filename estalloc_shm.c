@@ -0,0 +1,297 @@
+/*! @file
+  @brief
+  Process-shared memory pool of ESTALLOC over POSIX shared memory.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  STRATEGY
+   The pool is a POSIX shared memory object (shm_open), and each process
+   maps it at its own address. Build everything with ESTALLOC_OFFSET_LINK,
+   so that the links in the pool are offsets instead of pointers.
+   Processes hand off memory by offset. (est_ptr_to_off/est_off_to_ptr)
+
+   The pool is locked by a process-shared robust mutex. When a process
+   dies holding it (EOWNERDEAD), the pool may be broken in the middle of
+   est_malloc() or est_free(). With ESTALLOC_DEBUG, the next process
+   takes it over only if est_sanity_check() passes, and
+   est_shm_recovered() counts it. Otherwise the mutex is left
+   inconsistent, so it becomes ENOTRECOVERABLE and all later calls fail.
+
+  SHARED MEMORY OBJECT
+     | SHM_HEADER          | Memory pool (ESTALLOC) ...               |
+     +---------------------+------------------------------------------+
+     | lock, magic, length | see estalloc.c                           |
+  </pre>
+*/
+
+/***** Feature test switches ************************************************/
+#define _GNU_SOURCE
+
+/***** System headers *******************************************************/
+//@cond
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+//@endcond
+
+/***** Local headers ********************************************************/
+#include "estalloc_shm.h"
+
+#if !defined(ESTALLOC_OFFSET_LINK)
+# error "estalloc_shm.c needs ESTALLOC_OFFSET_LINK."
+#endif
+
+/***** Constant values ******************************************************/
+#define SHM_MAGIC 0x45534d31    // "ESM1"
+
+
+/***** Typedefs *************************************************************/
+typedef struct SHM_HEADER {
+  pthread_mutex_t lock;
+  uint32_t magic;         //!< set when the pool is ready.
+  uint32_t length;        //!< mapped length.
+  uint32_t recovered;     //!< number of EOWNERDEAD.
+  uint32_t pad;
+} SHM_HEADER;
+
+struct ESTALLOC_SHM {
+  SHM_HEADER header;
+  // aligned for the memory pool.
+} __attribute__((aligned(16)));
+
+#define SHM_POOL(shm) ((ESTALLOC *)((uint8_t *)(shm) + sizeof(ESTALLOC_SHM)))
+
+
+/***** Local functions ******************************************************/
+//================================================================
+/*! map the shared memory object
+
+  @param  fd      file descriptor.
+  @param  length  length.
+  @return ESTALLOC_SHM *  mapped address.
+  @retval NULL  error.
+*/
+static ESTALLOC_SHM *
+shm_map(int fd, size_t length)
+{
+  void *top = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  return (top == MAP_FAILED) ? NULL : top;
+}
+
+
+/***** Global functions *****************************************************/
+//================================================================
+/*! create a shared memory object and a memory pool on it
+
+  @param  name  name of the object. (e.g. "/estalloc")
+  @param  size  pool size.
+  @return ESTALLOC_SHM *  pointer to shared pool.
+  @retval NULL  error. (e.g. the name already exists)
+*/
+ESTALLOC_SHM *
+est_shm_create(const char *name, unsigned int size)
+{
+  size_t length = sizeof(ESTALLOC_SHM) + size;
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return NULL;
+  if (ftruncate(fd, length) != 0) {
+    close(fd);
+    shm_unlink(name);
+    return NULL;
+  }
+  ESTALLOC_SHM *shm = shm_map(fd, length);
+  if (shm == NULL) {
+    shm_unlink(name);
+    return NULL;
+  }
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&shm->header.lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  shm->header.length = length;
+  shm->header.recovered = 0;
+  est_init(SHM_POOL(shm), size);
+
+  // now other processes can use it.
+  __atomic_store_n(&shm->header.magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+  return shm;
+}
+
+
+//================================================================
+/*! map a shared pool created by est_shm_create()
+
+  @param  name  name of the object.
+  @return ESTALLOC_SHM *  pointer to shared pool. (at another address)
+  @retval NULL  error, or not ready yet.
+*/
+ESTALLOC_SHM *
+est_shm_open(const char *name)
+{
+  struct stat st;
+
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) return NULL;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ESTALLOC_SHM)) {
+    close(fd);
+    return NULL;
+  }
+  ESTALLOC_SHM *shm = shm_map(fd, st.st_size);
+  if (shm == NULL) return NULL;
+
+  if (__atomic_load_n(&shm->header.magic, __ATOMIC_ACQUIRE) != SHM_MAGIC) {
+    munmap(shm, st.st_size);
+    return NULL;
+  }
+
+  return shm;
+}
+
+
+//================================================================
+/*! unmap the shared pool from this process
+
+  @param  shm  Pointer to ESTALLOC_SHM.
+*/
+void
+est_shm_close(ESTALLOC_SHM *shm)
+{
+  if (shm == NULL) return;
+  munmap(shm, shm->header.length);
+}
+
+
+//================================================================
+/*! remove the name of the shared memory object
+
+  The memory is released when all processes have closed it.
+
+  @param  name  name of the object.
+  @retval 0     success.
+  @retval -1    error.
+*/
+int
+est_shm_unlink(const char *name)
+{
+  return shm_unlink(name);
+}
+
+
+//================================================================
+/*! lock the shared pool, taking it over from a dead process
+
+  @param  shm  Pointer to ESTALLOC_SHM.
+  @retval 0    success.
+  @retval -1   error. (e.g. the pool is broken. not locked)
+*/
+int
+est_shm_lock(ESTALLOC_SHM *shm)
+{
+  int ret = pthread_mutex_lock(&shm->header.lock);
+  if (ret != EOWNERDEAD) return (ret == 0) ? 0 : -1;
+
+#if defined(ESTALLOC_DEBUG)
+  if (est_sanity_check(SHM_POOL(shm)) == 0 &&
+      pthread_mutex_consistent(&shm->header.lock) == 0) {
+    shm->header.recovered++;
+    return 0;
+  }
+#endif
+  // unlock it not consistent. the pool is not used any more.
+  pthread_mutex_unlock(&shm->header.lock);
+  return -1;
+}
+
+
+//================================================================
+/*! unlock the shared pool
+
+  @param  shm  Pointer to ESTALLOC_SHM.
+*/
+void
+est_shm_unlock(ESTALLOC_SHM *shm)
+{
+  pthread_mutex_unlock(&shm->header.lock);
+}
+
+
+//================================================================
+/*! allocate memory from the shared pool
+
+  @param  shm   Pointer to ESTALLOC_SHM.
+  @param  size  request size.
+  @return void * pointer to allocated memory. (in this process)
+  @retval NULL  Out of memory, or the lock failed.
+*/
+void *
+est_shm_malloc(ESTALLOC_SHM *shm, unsigned int size)
+{
+  if (est_shm_lock(shm) != 0) return NULL;
+  void *ptr = est_malloc(SHM_POOL(shm), size);
+  est_shm_unlock(shm);
+  return ptr;
+}
+
+
+//================================================================
+/*! release memory to the shared pool
+
+  The memory may have been allocated by another process.
+
+  @param  shm  Pointer to ESTALLOC_SHM.
+  @param  ptr  pointer to allocated memory. (in this process)
+*/
+void
+est_shm_free(ESTALLOC_SHM *shm, void *ptr)
+{
+  if (ptr == NULL) return;
+
+  if (est_shm_lock(shm) != 0) return;
+  est_free(SHM_POOL(shm), ptr);
+  est_shm_unlock(shm);
+}
+
+
+//================================================================
+/*! memory pool in the shared memory object
+
+  Use it for est_ptr_to_off() and est_off_to_ptr(). Lock it by
+  est_shm_lock() for the other functions. (e.g. est_take_statistics())
+
+  @param  shm  Pointer to ESTALLOC_SHM.
+  @return ESTALLOC *  memory pool. (in this process)
+*/
+ESTALLOC *
+est_shm_pool(ESTALLOC_SHM *shm)
+{
+  return SHM_POOL(shm);
+}
+
+
+//================================================================
+/*! number of times the pool was taken over from a dead process
+
+  @param  shm  Pointer to ESTALLOC_SHM.
+  @retval unsigned int  count.
+*/
+unsigned int
+est_shm_recovered(ESTALLOC_SHM *shm)
+{
+  return __atomic_load_n(&shm->header.recovered, __ATOMIC_RELAXED);
+}
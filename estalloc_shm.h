@@ -0,0 +1,42 @@
+/*! @file
+  @brief
+  Process-shared memory pool of ESTALLOC over POSIX shared memory.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef ESTALLOC_SHM_H_
+#define ESTALLOC_SHM_H_
+
+#include "estalloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ESTALLOC_SHM ESTALLOC_SHM;
+
+ESTALLOC_SHM *est_shm_create(const char *name, unsigned int size);
+ESTALLOC_SHM *est_shm_open(const char *name);
+void est_shm_close(ESTALLOC_SHM *shm);
+int est_shm_unlink(const char *name);
+
+int est_shm_lock(ESTALLOC_SHM *shm);
+void est_shm_unlock(ESTALLOC_SHM *shm);
+
+void *est_shm_malloc(ESTALLOC_SHM *shm, unsigned int size);
+void est_shm_free(ESTALLOC_SHM *shm, void *ptr);
+
+ESTALLOC *est_shm_pool(ESTALLOC_SHM *shm);
+unsigned int est_shm_recovered(ESTALLOC_SHM *shm);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
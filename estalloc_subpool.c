@@ -0,0 +1,290 @@
+/*! @file
+  @brief
+  Hierarchical sub-pools of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  STRATEGY
+   A sub-pool is a memory pool on a block of the parent pool. (e.g. one
+   for each VM) Blocks of the sub-pool are never mixed with the others,
+   and est_subpool_destroy() returns the whole sub-pool to the parent
+   by one est_free(), however many blocks are left in it.
+
+   With est_subpool_set_grow(), a full sub-pool takes another chunk
+   from the parent and makes a memory pool on it. The owner chunk of
+   a block is found by address. The chunks are kept until destroyed.
+
+   The parent can be a sub-pool too. (see est_subpool_pool)
+   A sub-pool has no lock. Sub-pools of one parent can be used by
+   different threads only if the parent is locked, because creating,
+   growing and destroying use the parent.
+
+  SUB-POOL
+     | ESTALLOC_SUBPOOL | Memory pool (ESTALLOC) ...   |
+     +------------------+------------------------------+
+     | parent, chunk    | see estalloc.c               |
+
+     | SUBPOOL_CHUNK    | Memory pool (ESTALLOC) ...   |  (grown chunk)
+     +------------------+------------------------------+
+  </pre>
+*/
+
+/***** System headers *******************************************************/
+//@cond
+#include <stddef.h>
+#include <stdint.h>
+//@endcond
+
+/***** Local headers ********************************************************/
+#include "estalloc_subpool.h"
+
+/***** Macros ***************************************************************/
+#define HEADER_SIZE(type) \
+  ((sizeof(type) + ESTALLOC_ALIGNMENT - 1) & ~(size_t)(ESTALLOC_ALIGNMENT - 1))
+#define CHUNK_POOL(chunk, type) ((ESTALLOC *)((uint8_t *)(chunk) + HEADER_SIZE(type)))
+#define MAX_POOL_SIZE ((ESTALLOC_MEMSIZE_T)~0)
+
+
+/***** Typedefs *************************************************************/
+typedef struct SUBPOOL_CHUNK {
+  struct SUBPOOL_CHUNK *next;   //!< next grown chunk.
+  ESTALLOC *pool;
+  uint8_t *end;                 //!< end of the memory pool.
+} SUBPOOL_CHUNK;
+
+struct ESTALLOC_SUBPOOL {
+  ESTALLOC *parent;
+  unsigned int grow_size;       //!< 0: do not grow.
+  SUBPOOL_CHUNK chunk;          //!< the first chunk.
+};
+
+
+/***** Local functions ******************************************************/
+//================================================================
+/*! find the chunk that owns the memory
+
+  @param  sub  Pointer to ESTALLOC_SUBPOOL.
+  @param  ptr  pointer to memory.
+  @return SUBPOOL_CHUNK *  owner chunk.
+  @retval NULL  not in this sub-pool.
+*/
+static SUBPOOL_CHUNK *
+chunk_of(ESTALLOC_SUBPOOL *sub, const void *ptr)
+{
+  const uint8_t *p = ptr;
+
+  for (SUBPOOL_CHUNK *chunk = &sub->chunk; chunk; chunk = chunk->next) {
+    if ((const uint8_t *)chunk->pool <= p && p < chunk->end) return chunk;
+  }
+  return NULL;
+}
+
+
+//================================================================
+/*! take another chunk from the parent, and allocate from it
+
+  @param  sub   Pointer to ESTALLOC_SUBPOOL.
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory in the parent.
+*/
+static void *
+grow_malloc(ESTALLOC_SUBPOOL *sub, unsigned int size)
+{
+  const unsigned int max_size = MAX_POOL_SIZE - HEADER_SIZE(SUBPOOL_CHUNK);
+
+  unsigned int pool_size = (sub->grow_size < max_size) ? sub->grow_size : max_size;
+  if (size > pool_size / 2) {
+    pool_size = (size < max_size - pool_size) ? pool_size + size : max_size;
+  }
+  // at least the request fits. (+ block header and round-ups)
+  unsigned int min_size = est_min_pool_size() + ESTALLOC_ALIGNMENT * 4;
+  if (size < max_size - min_size && pool_size < min_size + size) pool_size = min_size + size;
+
+  SUBPOOL_CHUNK *chunk = est_malloc(sub->parent, HEADER_SIZE(SUBPOOL_CHUNK) + pool_size);
+  if (chunk == NULL) return NULL;
+
+  chunk->pool = est_init(CHUNK_POOL(chunk, SUBPOOL_CHUNK), pool_size);
+  chunk->end = (uint8_t *)chunk->pool + pool_size;
+
+  void *ptr = est_malloc(chunk->pool, size);
+  if (ptr == NULL) {
+    // too large request for a chunk.
+    est_free(sub->parent, chunk);
+    return NULL;
+  }
+
+  chunk->next = sub->chunk.next;
+  sub->chunk.next = chunk;
+
+  return ptr;
+}
+
+
+/***** Global functions *****************************************************/
+//================================================================
+/*! create a sub-pool on a block of the parent pool
+
+  @param  parent  Pointer to ESTALLOC.
+  @param  size    size of the sub-pool, including its header.
+  @return ESTALLOC_SUBPOOL *  pointer to sub-pool.
+  @retval NULL  Out of memory in the parent, or wrong size.
+*/
+ESTALLOC_SUBPOOL *
+est_subpool_create(ESTALLOC *parent, unsigned int size)
+{
+  if (size < HEADER_SIZE(ESTALLOC_SUBPOOL) + est_min_pool_size()) return NULL;
+  unsigned int pool_size = size - HEADER_SIZE(ESTALLOC_SUBPOOL);
+  if (pool_size > MAX_POOL_SIZE) return NULL;
+
+  ESTALLOC_SUBPOOL *sub = est_malloc(parent, size);
+  if (sub == NULL) return NULL;
+
+  sub->parent = parent;
+  sub->grow_size = 0;
+  sub->chunk.next = NULL;
+  sub->chunk.pool = est_init(CHUNK_POOL(sub, ESTALLOC_SUBPOOL), pool_size);
+  sub->chunk.end = (uint8_t *)sub->chunk.pool + pool_size;
+
+  return sub;
+}
+
+
+//================================================================
+/*! return the whole sub-pool to the parent
+
+  All blocks in the sub-pool are released at once.
+
+  @param  sub  Pointer to ESTALLOC_SUBPOOL.
+*/
+void
+est_subpool_destroy(ESTALLOC_SUBPOOL *sub)
+{
+  if (sub == NULL) return;
+
+  SUBPOOL_CHUNK *chunk = sub->chunk.next;
+  while (chunk) {
+    SUBPOOL_CHUNK *next = chunk->next;
+    est_free(sub->parent, chunk);
+    chunk = next;
+  }
+  est_free(sub->parent, sub);
+}
+
+
+//================================================================
+/*! let the sub-pool grow when it is full
+
+  @param  sub        Pointer to ESTALLOC_SUBPOOL.
+  @param  grow_size  pool size of a chunk taken from the parent. 0: do not grow.
+                     (at least est_min_pool_size())
+*/
+void
+est_subpool_set_grow(ESTALLOC_SUBPOOL *sub, unsigned int grow_size)
+{
+  sub->grow_size = grow_size;
+}
+
+
+//================================================================
+/*! allocate memory from the sub-pool
+
+  @param  sub   Pointer to ESTALLOC_SUBPOOL.
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+void *
+est_subpool_malloc(ESTALLOC_SUBPOOL *sub, unsigned int size)
+{
+  for (SUBPOOL_CHUNK *chunk = &sub->chunk; chunk; chunk = chunk->next) {
+    void *ptr = est_malloc(chunk->pool, size);
+    if (ptr) return ptr;
+  }
+
+  if (sub->grow_size == 0) return NULL;
+  return grow_malloc(sub, size);
+}
+
+
+//================================================================
+/*! release memory to the sub-pool
+
+  Memory of another pool is ignored.
+
+  @param  sub  Pointer to ESTALLOC_SUBPOOL.
+  @param  ptr  Return value of est_subpool_malloc()
+*/
+void
+est_subpool_free(ESTALLOC_SUBPOOL *sub, void *ptr)
+{
+  if (ptr == NULL) return;
+
+  SUBPOOL_CHUNK *chunk = chunk_of(sub, ptr);
+  if (chunk == NULL) return;
+
+  est_free(chunk->pool, ptr);
+}
+
+
+//================================================================
+/*! re-allocate memory, in the owner chunk if possible
+
+  @param  sub   Pointer to ESTALLOC_SUBPOOL.
+  @param  ptr   Return value of est_subpool_malloc()
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory. (ptr is not released)
+*/
+void *
+est_subpool_realloc(ESTALLOC_SUBPOOL *sub, void *ptr, unsigned int size)
+{
+  if (ptr == NULL) return est_subpool_malloc(sub, size);
+
+  SUBPOOL_CHUNK *chunk = chunk_of(sub, ptr);
+  if (chunk == NULL) return NULL;
+
+  void *new_ptr = est_realloc(chunk->pool, ptr, size);
+  if (new_ptr) return new_ptr;
+
+  // the owner chunk is full. move to another chunk, or a grown one.
+  new_ptr = est_subpool_malloc(sub, size);
+  if (new_ptr == NULL) return NULL;
+
+  return est_move(chunk->pool, ptr, new_ptr, size);
+}
+
+
+//================================================================
+/*! check if the memory belongs to the sub-pool
+
+  @param  sub  Pointer to ESTALLOC_SUBPOOL.
+  @param  ptr  pointer to memory.
+  @retval 1  in this sub-pool.
+  @retval 0  not.
+*/
+int
+est_subpool_contains(ESTALLOC_SUBPOOL *sub, const void *ptr)
+{
+  return chunk_of(sub, ptr) != NULL;
+}
+
+
+//================================================================
+/*! memory pool of the first chunk
+
+  Use it as the parent of nested sub-pools, or for the other functions.
+  (e.g. est_take_statistics())
+
+  @param  sub  Pointer to ESTALLOC_SUBPOOL.
+  @return ESTALLOC *  memory pool.
+*/
+ESTALLOC *
+est_subpool_pool(ESTALLOC_SUBPOOL *sub)
+{
+  return sub->chunk.pool;
+}
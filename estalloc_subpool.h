@@ -0,0 +1,39 @@
+/*! @file
+  @brief
+  Hierarchical sub-pools of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef ESTALLOC_SUBPOOL_H_
+#define ESTALLOC_SUBPOOL_H_
+
+#include "estalloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ESTALLOC_SUBPOOL ESTALLOC_SUBPOOL;
+
+ESTALLOC_SUBPOOL *est_subpool_create(ESTALLOC *parent, unsigned int size);
+void est_subpool_destroy(ESTALLOC_SUBPOOL *sub);
+void est_subpool_set_grow(ESTALLOC_SUBPOOL *sub, unsigned int grow_size);
+
+void *est_subpool_malloc(ESTALLOC_SUBPOOL *sub, unsigned int size);
+void est_subpool_free(ESTALLOC_SUBPOOL *sub, void *ptr);
+void *est_subpool_realloc(ESTALLOC_SUBPOOL *sub, void *ptr, unsigned int size);
+
+int est_subpool_contains(ESTALLOC_SUBPOOL *sub, const void *ptr);
+ESTALLOC *est_subpool_pool(ESTALLOC_SUBPOOL *sub);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
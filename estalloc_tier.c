@@ -0,0 +1,229 @@
+/*! @file
+  @brief
+  Memory tier front end of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  STRATEGY
+   Each tier is a memory pool with its own free lists, on its own
+   memory region. (e.g. internal SRAM and PSRAM on ESP32. On Linux,
+   a plain buffer and a hugepage-backed one.) Tiers are added from
+   the fastest to the slowest, and the owner of a block is found by
+   address. est_malloc_tier() allocates from the preferred tier, and
+   with EST_TIER_FALLBACK, from the slower tiers and then the faster
+   ones. est_tier_migrate() moves a block to another tier by copy.
+
+   No system calls are used. Lock it by yourself if needed.
+  </pre>
+*/
+
+/***** System headers *******************************************************/
+//@cond
+#include <stddef.h>
+#include <stdint.h>
+//@endcond
+
+/***** Local headers ********************************************************/
+#include "estalloc_tier.h"
+
+
+/***** Local functions ******************************************************/
+//================================================================
+/*! allocate from the tiers in fallback order
+
+  @param  tier   Pointer to ESTALLOC_TIER.
+  @param  size   request size.
+  @param  first  preferred tier.
+  @param  skip   tier to skip, or -1.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+static void *
+fallback_malloc(ESTALLOC_TIER *tier, unsigned int size, int first, int skip)
+{
+  // slower tiers first, to keep the fast memory for the hot data.
+  for (int n = first + 1; n < (int)tier->num_tiers; n++) {
+    if (n == skip) continue;
+    void *ptr = est_malloc(tier->pools[n], size);
+    if (ptr) return ptr;
+  }
+  for (int n = first - 1; n >= 0; n--) {
+    if (n == skip) continue;
+    void *ptr = est_malloc(tier->pools[n], size);
+    if (ptr) return ptr;
+  }
+  return NULL;
+}
+
+
+/***** Global functions *****************************************************/
+//================================================================
+/*! initialize with no tier
+
+  @param  tier  Pointer to ESTALLOC_TIER.
+*/
+void
+est_tier_init(ESTALLOC_TIER *tier)
+{
+  tier->num_tiers = 0;
+  for (int i = 0; i < ESTALLOC_TIER_MAX_TIERS; i++) {
+    tier->pools[i] = NULL;
+    tier->ends[i] = NULL;
+  }
+}
+
+
+//================================================================
+/*! add a memory region as the next (slower) tier
+
+  @param  tier  Pointer to ESTALLOC_TIER.
+  @param  ptr   pointer to free memory block. (see est_init())
+  @param  size  size.
+  @return int   tier number.
+  @retval -1    too many tiers.
+*/
+int
+est_tier_add(ESTALLOC_TIER *tier, void *ptr, unsigned int size)
+{
+  if (tier->num_tiers >= ESTALLOC_TIER_MAX_TIERS) return -1;
+
+  int n = tier->num_tiers;
+  tier->pools[n] = est_init(ptr, size);
+  tier->ends[n] = (uint8_t *)ptr + size;
+  tier->num_tiers++;
+
+  return n;
+}
+
+
+//================================================================
+/*! allocate memory on the preferred tier
+
+  @param  tier            Pointer to ESTALLOC_TIER.
+  @param  size            request size.
+  @param  preferred_tier  tier number.
+  @param  fallback        EST_TIER_NO_FALLBACK or EST_TIER_FALLBACK.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory.
+*/
+void *
+est_malloc_tier(ESTALLOC_TIER *tier, unsigned int size, int preferred_tier, int fallback)
+{
+  if (preferred_tier < 0 || preferred_tier >= (int)tier->num_tiers) return NULL;
+
+  void *ptr = est_malloc(tier->pools[preferred_tier], size);
+  if (ptr || fallback == EST_TIER_NO_FALLBACK) return ptr;
+
+  return fallback_malloc(tier, size, preferred_tier, -1);
+}
+
+
+//================================================================
+/*! release memory to the owning tier
+
+  @param  tier  Pointer to ESTALLOC_TIER.
+  @param  ptr   Return value of est_malloc_tier()
+*/
+void
+est_tier_free(ESTALLOC_TIER *tier, void *ptr)
+{
+  if (ptr == NULL) return;
+
+  int n = est_tier_of(tier, ptr);
+  if (n < 0) return;
+
+  est_free(tier->pools[n], ptr);
+}
+
+
+//================================================================
+/*! re-allocate memory, on the owning tier if possible
+
+  @param  tier  Pointer to ESTALLOC_TIER.
+  @param  ptr   Return value of est_malloc_tier()
+  @param  size  request size.
+  @return void * pointer to allocated memory.
+  @retval NULL  Out of memory. (ptr is not released)
+*/
+void *
+est_tier_realloc(ESTALLOC_TIER *tier, void *ptr, unsigned int size)
+{
+  if (ptr == NULL) return est_malloc_tier(tier, size, 0, EST_TIER_FALLBACK);
+
+  int n = est_tier_of(tier, ptr);
+  if (n < 0) return NULL;
+
+  void *new_ptr = est_realloc(tier->pools[n], ptr, size);
+  if (new_ptr) return new_ptr;
+
+  // the owning tier is full. move to the others.
+  new_ptr = fallback_malloc(tier, size, n, n);
+  if (new_ptr == NULL) return NULL;
+
+  return est_move(tier->pools[n], ptr, new_ptr, size);
+}
+
+
+//================================================================
+/*! move a block to another tier
+
+  The contents are copied, and the old block is released.
+
+  @param  tier     Pointer to ESTALLOC_TIER.
+  @param  ptr      Return value of est_malloc_tier()
+  @param  to_tier  destination tier number.
+  @return void * pointer to the moved memory.
+  @retval NULL  Out of memory in the destination. (ptr is not moved)
+*/
+void *
+est_tier_migrate(ESTALLOC_TIER *tier, void *ptr, int to_tier)
+{
+  int n = est_tier_of(tier, ptr);
+  if (n < 0 || to_tier < 0 || to_tier >= (int)tier->num_tiers) return NULL;
+  if (n == to_tier) return ptr;
+
+  unsigned int len = est_usable_size(tier->pools[n], ptr);
+  void *new_ptr = est_malloc(tier->pools[to_tier], len);
+  if (new_ptr == NULL) return NULL;
+
+  return est_move(tier->pools[n], ptr, new_ptr, len);
+}
+
+
+//================================================================
+/*! tier that owns ptr
+
+  @param  tier  Pointer to ESTALLOC_TIER.
+  @param  ptr   Return value of est_malloc_tier()
+  @retval int   tier number.
+  @retval -1    not allocated by these tiers.
+*/
+int
+est_tier_of(ESTALLOC_TIER *tier, void *ptr)
+{
+  uint8_t *p = ptr;
+  for (unsigned int i = 0; i < tier->num_tiers; i++) {
+    if ((uint8_t *)tier->pools[i] < p && p < tier->ends[i]) return i;
+  }
+  return -1;
+}
+
+
+//================================================================
+/*! memory pool of the tier
+
+  @param  tier  Pointer to ESTALLOC_TIER.
+  @param  n     tier number.
+  @return ESTALLOC *  memory pool.
+  @retval NULL  no such tier.
+*/
+ESTALLOC *
+est_tier_pool(ESTALLOC_TIER *tier, int n)
+{
+  if (n < 0 || n >= (int)tier->num_tiers) return NULL;
+  return tier->pools[n];
+}
@@ -0,0 +1,56 @@
+/*! @file
+  @brief
+  Memory tier front end of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  </pre>
+*/
+
+#ifndef ESTALLOC_TIER_H_
+#define ESTALLOC_TIER_H_
+
+#include "estalloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !defined(ESTALLOC_TIER_MAX_TIERS)
+# define ESTALLOC_TIER_MAX_TIERS 4
+#endif
+
+/*!@brief
+  Fallback flags for est_malloc_tier function.
+*/
+#define EST_TIER_NO_FALLBACK  0   // only the preferred tier
+#define EST_TIER_FALLBACK     1   // then the slower tiers, and the faster ones
+
+/*!@brief
+  Memory tiers. Tier 0 is the fastest.
+*/
+typedef struct ESTALLOC_TIER {
+  unsigned int num_tiers;
+  ESTALLOC *pools[ESTALLOC_TIER_MAX_TIERS];
+  uint8_t *ends[ESTALLOC_TIER_MAX_TIERS];
+} ESTALLOC_TIER;
+
+void est_tier_init(ESTALLOC_TIER *tier);
+int est_tier_add(ESTALLOC_TIER *tier, void *ptr, unsigned int size);
+
+void *est_malloc_tier(ESTALLOC_TIER *tier, unsigned int size, int preferred_tier, int fallback);
+void est_tier_free(ESTALLOC_TIER *tier, void *ptr);
+void *est_tier_realloc(ESTALLOC_TIER *tier, void *ptr, unsigned int size);
+void *est_tier_migrate(ESTALLOC_TIER *tier, void *ptr, int to_tier);
+
+int est_tier_of(ESTALLOC_TIER *tier, void *ptr);
+ESTALLOC *est_tier_pool(ESTALLOC_TIER *tier, int n);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
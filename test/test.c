@@ -32,7 +32,11 @@ enum operation_type {
   CALLOC = 1,
   REALLOC = 2,
   PERMALLOC = 3,
-  FREE = 4
+  FREE = 4,
+  MEMALIGN = 5,
+  MALLOC_HINT = 6,
+  MALLOC_SG = 7,
+  TRY_EXPAND = 8
 };
 
 typedef struct {
@@ -92,6 +96,386 @@ print_sanity_error(int error_code)
   if (error_code & 0x04) printf("- Invalid next block address\n");
   if (error_code & 0x08) printf("- Previous block usage flag inconsistency (used->free)\n");
   if (error_code & 0x10) printf("- Previous block usage flag inconsistency (free->used)\n");
+  if (error_code & 0x20) printf("- Block index inconsistency\n");
+}
+#endif
+
+// Check the pool after a test, under ESTALLOC_DEBUG
+static int
+check_pool(ESTALLOC *est, const char *name)
+{
+#ifdef ESTALLOC_DEBUG
+  int result = est_sanity_check(est);
+  if (result != 0) {
+    printf("FATAL: %s broke the memory pool\n", name);
+    print_sanity_error(result);
+    return 1;
+  }
+#else
+  (void)est;
+  (void)name;
+#endif
+  return 0;
+}
+
+// Check est_memalign() with various alignments
+static int
+test_memalign(ESTALLOC *est)
+{
+  void *ptrs[8];
+  for (int i = 0; i < 8; i++) {
+    unsigned int alignment = 16u << i;
+    ptrs[i] = est_memalign(est, alignment, 100 * (i + 1));
+    if (ptrs[i] == NULL || ((uintptr_t)ptrs[i] & (alignment - 1)) != 0) {
+      printf("FATAL: est_memalign(%u) returned %p\n", alignment, ptrs[i]);
+      return 1;
+    }
+    fill_memory(ptrs[i], 100 * (i + 1), 0xDD);
+  }
+  for (int i = 0; i < 8; i++) {
+    if (!check_memory_content(ptrs[i], 100 * (i + 1), 0xDD)) {
+      printf("FATAL: est_memalign memory was overwritten!\n");
+      return 1;
+    }
+    est_free(est, ptrs[i]);
+  }
+
+  // small requests in the only hole, of various sizes and misalignments.
+  static uint64_t memory[4096 / sizeof(uint64_t)];
+  for (unsigned int hole_size = 128; hole_size < 256; hole_size += ESTALLOC_ALIGNMENT) {
+    for (unsigned int shift = 0; shift < 128; shift += ESTALLOC_ALIGNMENT) {
+      ESTALLOC *small = est_init(memory, sizeof(memory));
+      void *pad = est_malloc(small, shift + 1);
+      void *hole = est_malloc(small, hole_size);
+      if (pad == NULL || hole == NULL) return 1;
+      for (unsigned int size = 256; size > 0; size /= 2) {
+        while (est_malloc(small, size) != NULL) ;
+      }
+      est_free(small, hole);
+      void *ptr = est_memalign(small, 128, 1);
+      if (ptr != NULL && ((uintptr_t)ptr & 127) != 0) {
+        printf("FATAL: est_memalign(128, 1) returned %p\n", ptr);
+        return 1;
+      }
+    }
+  }
+
+  return check_pool(est, "est_memalign");
+}
+
+// Check size feedback
+static int
+test_malloc_sized(ESTALLOC *est)
+{
+  for (unsigned int size = 1; size < 300; size += 7) {
+    unsigned int usable;
+    uint8_t *ptr = est_malloc_sized(est, size, &usable);
+    if (ptr == NULL || usable < est_good_size(size) || est_good_size(size) < size ||
+        usable != est_usable_size(est, ptr)) {
+      printf("FATAL: est_malloc_sized(%u) usable %u, good size %u\n", size, usable, est_good_size(size));
+      return 1;
+    }
+    fill_memory(ptr, usable, 0xBB);
+    est_free(est, ptr);
+  }
+  return check_pool(est, "est_malloc_sized");
+}
+
+// Check lifetime hint placement
+static int
+test_malloc_hint(ESTALLOC *est)
+{
+  uint8_t *s1 = est_malloc_hint(est, 40, EST_HINT_SHORT_LIVED);
+  uint8_t *l1 = est_malloc_hint(est, 40, EST_HINT_LONG_LIVED);
+  uint8_t *s2 = est_malloc_hint(est, 100, EST_HINT_SHORT_LIVED);
+  uint8_t *l2 = est_malloc_hint(est, 100, EST_HINT_LONG_LIVED);
+  if (s1 == NULL || l1 == NULL || s2 == NULL || l2 == NULL) return 1;
+  fill_memory(s1, 40, 0x11);
+  fill_memory(l1, 40, 0x22);
+  fill_memory(s2, 100, 0x33);
+  fill_memory(l2, 100, 0x44);
+
+  // long-lived blocks are placed above short-lived ones.
+  if (l1 < s2 || l2 < s2 || l1 < s1) {
+    printf("FATAL: est_malloc_hint placed long-lived %p %p below short-lived %p %p\n", l1, l2, s1, s2);
+    return 1;
+  }
+  if (!check_memory_content(s1, 40, 0x11) || !check_memory_content(l1, 40, 0x22) ||
+      !check_memory_content(s2, 100, 0x33) || !check_memory_content(l2, 100, 0x44)) {
+    printf("FATAL: est_malloc_hint blocks overlap\n");
+    return 1;
+  }
+  est_free(est, s1);
+  est_free(est, l2);
+  est_free(est, s2);
+  est_free(est, l1);
+  return check_pool(est, "est_malloc_hint");
+}
+
+// Check est_malloc_sg() on a fragmented pool
+static int
+test_malloc_sg(void)
+{
+  static uint64_t memory[4096 / sizeof(uint64_t)];
+  ESTALLOC *est = est_init(memory, sizeof(memory));
+  void *ptrs[32];
+  int n = 0;
+
+  // leave 200 byte holes between used blocks.
+  while (n < 32 && (ptrs[n] = est_malloc(est, 200)) != NULL) n++;
+  for (int i = 0; i < n; i += 2) est_free(est, ptrs[i]);
+
+  ESTALLOC_IOVEC iov[16];
+  if (est_malloc(est, 1000) != NULL || est_malloc_sg(est, 1000, 2, iov) != 0) {
+    printf("FATAL: the pool for est_malloc_sg is not fragmented\n");
+    return 1;
+  }
+  unsigned int num = est_malloc_sg(est, 1000, 16, iov);
+  size_t total = 0;
+  for (unsigned int i = 0; i < num; i++) {
+    fill_memory(iov[i].iov_base, iov[i].iov_len, 0x30 + i);
+    total += iov[i].iov_len;
+  }
+  if (num < 2 || total != 1000) {
+    printf("FATAL: est_malloc_sg returned %u segments, %u bytes\n", num, (unsigned int)total);
+    return 1;
+  }
+  for (unsigned int i = 0; i < num; i++) {
+    if (!check_memory_content(iov[i].iov_base, iov[i].iov_len, 0x30 + i)) {
+      printf("FATAL: est_malloc_sg segments overlap\n");
+      return 1;
+    }
+  }
+  est_free_sg(est, num, iov);
+
+#ifdef ESTALLOC_DESIGNATED_VICTIM
+  // the victim is not in the bins, but counts as a segment.
+  static uint64_t memory2[2048 / sizeof(uint64_t)];
+  est = est_init(memory2, sizeof(memory2));
+  uint8_t *hole1 = est_malloc(est, 200);
+  uint8_t *guard = est_malloc(est, 40);
+  uint8_t *hole2 = est_malloc(est, 200);
+  for (unsigned int size = 1024; size > 0; size /= 4) {
+    while (est_malloc(est, size) != NULL) ;
+  }
+  est_free(est, hole1);
+  est_free(est, hole2);
+  if (guard == NULL || est_malloc(est, 40) == NULL) return 1;   // the rest of a hole is the victim.
+  num = est_malloc_sg(est, 300, 16, iov);
+  if (num != 2) {
+    printf("FATAL: est_malloc_sg did not take the victim\n");
+    return 1;
+  }
+  est_free_sg(est, num, iov);
+#endif
+
+  return check_pool(est, "est_malloc_sg");
+}
+
+// Check in-place expansion
+static int
+test_try_expand(ESTALLOC *est)
+{
+  uint8_t *a = est_malloc(est, 40);
+  uint8_t *b = est_malloc(est, 200);
+  uint8_t *c = est_malloc(est, 40);
+  if (a == NULL || b == NULL || c == NULL) return 1;
+  fill_memory(a, 40, 0xCC);
+
+  unsigned int usable = est_usable_size(est, a);
+  if (est_try_expand(est, a, usable + 1, usable + 1) != 0) {
+    printf("FATAL: est_try_expand expanded into a used block\n");
+    return 1;
+  }
+  est_free(est, b);
+  unsigned int expanded = est_try_expand(est, a, 100, 120);
+  if (expanded < 100 || expanded > 120 + ESTALLOC_ALIGNMENT * 2 + 32 ||
+      expanded != est_usable_size(est, a) || !check_memory_content(a, 40, 0xCC)) {
+    printf("FATAL: est_try_expand returned %u\n", expanded);
+    return 1;
+  }
+  fill_memory(a, expanded, 0xCC);
+  if (est_try_expand(est, a, 1000, 1000) != 0) {
+    printf("FATAL: est_try_expand exceeded the free block\n");
+    return 1;
+  }
+  est_free(est, a);
+  est_free(est, c);
+  return check_pool(est, "est_try_expand");
+}
+
+#ifdef ESTALLOC_DESIGNATED_VICTIM
+// Check small requests are carved sequentially from the victim
+static int
+test_designated_victim(ESTALLOC *est)
+{
+  uint8_t *hole = est_malloc(est, 40);
+  uint8_t *guard1 = est_malloc(est, 40);
+  uint8_t *mid = est_malloc(est, 200);
+  uint8_t *guard2 = est_malloc(est, 40);
+  if (hole == NULL || guard1 == NULL || mid == NULL || guard2 == NULL) return 1;
+  est_free(est, mid);
+
+  // the first one splits a block, and the others follow it.
+  uint8_t *p[4];
+  for (int i = 0; i < 3; i++) {
+    p[i] = est_malloc(est, 40);
+    if (p[i] == NULL) return 1;
+  }
+  for (int i = 1; i < 3; i++) {
+    if (p[i] <= p[i-1] || p[i] - p[i-1] > est_usable_size(est, p[i-1]) + 16) {
+      printf("FATAL: %p is not next to %p\n", p[i], p[i-1]);
+      return 1;
+    }
+  }
+
+  // the exact size free block comes before the victim.
+  est_free(est, hole);
+  p[3] = est_malloc(est, 40);
+  if (p[3] != hole) {
+    printf("FATAL: the victim was used instead of a free block of the same size\n");
+    return 1;
+  }
+
+  for (int i = 0; i < 4; i++) est_free(est, p[i]);
+  est_free(est, guard1);
+  est_free(est, guard2);
+  return check_pool(est, "the designated victim");
+}
+#endif
+
+#ifdef ESTALLOC_REFCOUNT
+// Check the last est_release() frees the memory
+static int
+test_refcount(ESTALLOC *est)
+{
+  uint8_t *buf = est_malloc_rc(est, 100);
+  if (buf == NULL) return 1;
+  fill_memory(buf, 100, 0x77);
+
+  est_retain(buf);
+  est_retain(buf);
+  if (est_release(est, buf) != 2 || est_release(est, buf) != 1 ||
+      !check_memory_content(buf, 100, 0x77)) {
+    printf("FATAL: est_release released the memory too early\n");
+    return 1;
+  }
+  if (est_release(est, buf) != 0) {
+    printf("FATAL: the last est_release did not release the memory\n");
+    return 1;
+  }
+  return check_pool(est, "est_release");
+}
+#endif
+
+#ifdef ESTALLOC_ISR_RESERVE
+// Check the reserve for interrupt context
+static int
+test_isr_reserve(ESTALLOC *est)
+{
+  void *ptrs[4];
+  if (est_isr_reserve(est, 4, 48) != 0) {
+    printf("FATAL: est_isr_reserve failed\n");
+    return 1;
+  }
+  if (est_malloc_isr(est, 49) != NULL) {
+    printf("FATAL: est_malloc_isr accepted too large size\n");
+    return 1;
+  }
+  for (int i = 0; i < 4; i++) {
+    ptrs[i] = est_malloc_isr(est, 48);
+    if (ptrs[i] == NULL) {
+      printf("FATAL: est_malloc_isr failed\n");
+      return 1;
+    }
+    fill_memory(ptrs[i], 48, 0xEE);
+  }
+  if (est_malloc_isr(est, 48) != NULL) {
+    printf("FATAL: est_malloc_isr exceeded the reserve\n");
+    return 1;
+  }
+  est_free_isr(est, ptrs[0]);
+  if (est_malloc_isr(est, 16) != ptrs[0]) {
+    printf("FATAL: est_free_isr did not return the block\n");
+    return 1;
+  }
+  // release to the pool from normal context, and refill.
+  for (int i = 0; i < 4; i++) {
+    est_free(est, ptrs[i]);
+  }
+  if (est_isr_reserve(est, 2, 48) != 0 || est_malloc_isr(est, 48) == NULL) {
+    printf("FATAL: est_isr_reserve did not refill\n");
+    return 1;
+  }
+  return 0;
+}
+#endif
+
+#ifdef ESTALLOC_BLOCK_INDEX
+// Check interior pointer lookup
+static int
+test_block_of(ESTALLOC *est)
+{
+  uint8_t *ptrs[16];
+  int used;
+  for (int i = 0; i < 16; i++) {
+    ptrs[i] = est_malloc(est, 24 * (i + 1));
+    if (ptrs[i] == NULL) return 1;
+  }
+  for (int i = 0; i < 16; i += 2) {
+    est_free(est, ptrs[i]);
+  }
+  for (int i = 1; i < 16; i += 2) {
+    for (int j = 0; j < 24 * (i + 1); j += 7) {
+      if (est_block_of(est, ptrs[i] + j, &used) != ptrs[i] || !used) {
+        printf("FATAL: est_block_of(%p) did not return %p\n", ptrs[i] + j, ptrs[i]);
+        return 1;
+      }
+    }
+    if (est_block_of(est, ptrs[i - 1], &used) == NULL || used) {
+      printf("FATAL: est_block_of(%p) did not return free block\n", ptrs[i - 1]);
+      return 1;
+    }
+    est_free(est, ptrs[i]);
+  }
+  if (est_block_of(est, est, &used) != NULL) {
+    printf("FATAL: est_block_of() returned pool header\n");
+    return 1;
+  }
+  return 0;
+}
+#endif
+
+#ifdef ESTALLOC_DEBUG
+// Test est_take_overhead()
+static int
+test_overhead(ESTALLOC *est)
+{
+  ESTALLOC_OVERHEAD before, after;
+  est_take_overhead(est, &before, 0);
+  void *ptr = est_malloc(est, 17);
+  est_take_overhead(est, &after, 0);
+  est_take_statistics(est);
+
+  ESTALLOC_MEMSIZE_T sum = after.pool_header + after.block_headers + after.requested +
+    after.slack + after.free + after.unusable_free + after.permalloc + after.sentinel;
+  if (sum != est->stat.total) {
+    printf("FATAL: est_take_overhead sum %u != pool size %u\n", sum, est->stat.total);
+    return 1;
+  }
+  if (after.used_blocks != before.used_blocks + 1 ||
+      after.requested + after.slack != before.requested + before.slack + est_usable_size(est, ptr)) {
+    printf("FATAL: est_take_overhead did not count the block\n");
+    return 1;
+  }
+#ifdef ESTALLOC_TRACK_REQUESTED_SIZE
+  if (after.requested != before.requested + 17) {
+    printf("FATAL: est_take_overhead requested %u, expected %u\n", after.requested, before.requested + 17);
+    return 1;
+  }
+#endif
+  est_free(est, ptr);
+  return 0;
 }
 #endif
 
@@ -116,6 +500,18 @@ log_operation(enum operation_type op, void *ptr, size_t size, int result)
     case FREE:
       operation = "FREE";
       break;
+    case MEMALIGN:
+      operation = "MEMALIGN";
+      break;
+    case MALLOC_HINT:
+      operation = "HINT";
+      break;
+    case MALLOC_SG:
+      operation = "SG";
+      break;
+    case TRY_EXPAND:
+      operation = "EXPAND";
+      break;
     default:
       operation = "UNKNOWN";
       break;
@@ -144,7 +540,65 @@ main()
   ESTALLOC *est = est_init(pool_memory, POOL_SIZE);
   printf("Memory pool initialized at %p, size: %d bytes\n", pool_memory, POOL_SIZE);
 
+  if (test_memalign(est) != 0) {
+    fprintf(stderr, "Test failed: est_memalign\n");
+    return 1;
+  }
+
+  if (test_malloc_sized(est) != 0) {
+    fprintf(stderr, "Test failed: est_malloc_sized\n");
+    return 1;
+  }
+
+  if (test_malloc_hint(est) != 0) {
+    fprintf(stderr, "Test failed: est_malloc_hint\n");
+    return 1;
+  }
+
+  if (test_malloc_sg() != 0) {
+    fprintf(stderr, "Test failed: est_malloc_sg\n");
+    return 1;
+  }
+
+  if (test_try_expand(est) != 0) {
+    fprintf(stderr, "Test failed: est_try_expand\n");
+    return 1;
+  }
+
+#ifdef ESTALLOC_DESIGNATED_VICTIM
+  if (test_designated_victim(est) != 0) {
+    fprintf(stderr, "Test failed: designated victim\n");
+    return 1;
+  }
+#endif
+
+#ifdef ESTALLOC_REFCOUNT
+  if (test_refcount(est) != 0) {
+    fprintf(stderr, "Test failed: reference count\n");
+    return 1;
+  }
+#endif
+
+#ifdef ESTALLOC_ISR_RESERVE
+  if (test_isr_reserve(est) != 0) {
+    fprintf(stderr, "Test failed: ISR reserve\n");
+    return 1;
+  }
+#endif
+
+#ifdef ESTALLOC_BLOCK_INDEX
+  if (test_block_of(est) != 0) {
+    fprintf(stderr, "Test failed: est_block_of\n");
+    return 1;
+  }
+#endif
+
 #ifdef ESTALLOC_DEBUG
+  if (test_overhead(est) != 0) {
+    fprintf(stderr, "Test failed: est_take_overhead\n");
+    return 1;
+  }
+
   // Start profiling if debug is enabled
   est_start_profiling(est);
 #endif
@@ -157,6 +611,7 @@ main()
   int alloc_count = 0;
   int total_ops = 0;
   int malloc_ops = 0, calloc_ops = 0, realloc_ops = 0, free_ops = 0, permalloc_ops = 0;
+  int memalign_ops = 0, hint_ops = 0, sg_ops = 0, expand_ops = 0;
 
   // Main test loop
   for (int i = 0; i < MAX_ITERATIONS; i++) {
@@ -180,7 +635,7 @@ main()
     // Decide what operation to perform (with bias towards allocation)
     int op = rand() % 100;
 
-    if (op < 40 || alloc_count < 10) {  // 40% chance of malloc or when few allocations exist
+    if (op < 30 || alloc_count < 10) {  // 30% chance of malloc or when few allocations exist
       // Allocate memory
       size_t size = (rand() % MAX_ALLOC_SIZE) + 1;
       void *ptr = est_malloc(est, size);
@@ -205,7 +660,45 @@ main()
         log_operation(MALLOC, NULL, size, 0);
       }
     }
-    else if (op < 60 && alloc_count < MAX_ALLOCS) {  // 20% chance of calloc
+    else if (op < 35 && alloc_count < MAX_ALLOCS) {  // 5% chance of memalign
+      unsigned int alignment = 16u << (rand() % 6);
+      size_t size = (rand() % MAX_ALLOC_SIZE) + 1;
+      void *ptr = est_memalign(est, alignment, size);
+
+      if (ptr) {
+        if (((uintptr_t)ptr & (alignment - 1)) != 0) {
+          printf("FATAL: est_memalign(%u) returned %p\n", alignment, ptr);
+          return 1;
+        }
+        allocs[alloc_count].ptr = ptr;
+        allocs[alloc_count].size = size;
+        allocs[alloc_count].type = MEMALIGN;
+        alloc_count++;
+        fill_memory(ptr, size, 0x99);
+        log_operation(MEMALIGN, ptr, size, 1);
+        memalign_ops++;
+      } else {
+        log_operation(MEMALIGN, NULL, size, 0);
+      }
+    }
+    else if (op < 40 && alloc_count < MAX_ALLOCS) {  // 5% chance of malloc with lifetime hint
+      int hint = (rand() % 2) ? EST_HINT_SHORT_LIVED : EST_HINT_LONG_LIVED;
+      size_t size = (rand() % MAX_ALLOC_SIZE) + 1;
+      void *ptr = est_malloc_hint(est, size, hint);
+
+      if (ptr) {
+        allocs[alloc_count].ptr = ptr;
+        allocs[alloc_count].size = size;
+        allocs[alloc_count].type = MALLOC_HINT;
+        alloc_count++;
+        fill_memory(ptr, size, 0x99);
+        log_operation(MALLOC_HINT, ptr, size, 1);
+        hint_ops++;
+      } else {
+        log_operation(MALLOC_HINT, NULL, size, 0);
+      }
+    }
+    else if (op < 55 && alloc_count < MAX_ALLOCS) {  // 15% chance of calloc
       // Allocate and zero-initialize memory
       size_t nmemb = (rand() % 100) + 1;
       size_t size = (rand() % 100) + 1;
@@ -228,7 +721,7 @@ main()
         log_operation(CALLOC, NULL, nmemb * size, 0);
       }
     }
-    else if (op < 75 && alloc_count > 0) {  // 15% chance of realloc (when allocations exist)
+    else if (op < 65 && alloc_count > 0) {  // 10% chance of realloc (when allocations exist)
       // Resize existing allocation
       int idx = rand() % alloc_count;
 
@@ -262,6 +755,53 @@ main()
         log_operation(REALLOC, NULL, new_size, 0);
       }
     }
+    else if (op < 70 && alloc_count > 0) {  // 5% chance of in-place expansion
+      int idx = rand() % alloc_count;
+      if (allocs[idx].type == PERMALLOC) {
+        continue;
+      }
+
+      unsigned int min_size = allocs[idx].size + (rand() % 256) + 1;
+      unsigned int max_size = min_size + (rand() % 256);
+      fill_memory(allocs[idx].ptr, allocs[idx].size, 0xAA);
+
+      unsigned int expanded = est_try_expand(est, allocs[idx].ptr, min_size, max_size);
+      if (expanded) {
+        if (expanded < min_size || expanded != est_usable_size(est, allocs[idx].ptr) ||
+            !check_memory_content(allocs[idx].ptr, allocs[idx].size, 0xAA)) {
+          printf("FATAL: est_try_expand(%u, %u) returned %u\n", min_size, max_size, expanded);
+          return 1;
+        }
+        fill_memory(allocs[idx].ptr, expanded, 0xAA);
+        allocs[idx].size = expanded;
+        expand_ops++;
+      }
+      log_operation(TRY_EXPAND, allocs[idx].ptr, min_size, expanded != 0);
+    }
+    else if (op < 75) {  // 5% chance of scatter-gather allocation, freed at once
+      ESTALLOC_IOVEC iov[8];
+      unsigned int total = (rand() % (MAX_ALLOC_SIZE * 4)) + 1;
+      unsigned int num = est_malloc_sg(est, total, 8, iov);
+      size_t sum = 0;
+
+      for (unsigned int j = 0; j < num; j++) {
+        fill_memory(iov[j].iov_base, iov[j].iov_len, 0x40 + j);
+        sum += iov[j].iov_len;
+      }
+      for (unsigned int j = 0; j < num; j++) {
+        if (!check_memory_content(iov[j].iov_base, iov[j].iov_len, 0x40 + j)) {
+          printf("FATAL: est_malloc_sg segments overlap\n");
+          return 1;
+        }
+      }
+      if (num != 0 && sum != total) {
+        printf("FATAL: est_malloc_sg returned %u bytes for %u\n", (unsigned int)sum, total);
+        return 1;
+      }
+      est_free_sg(est, num, iov);
+      log_operation(MALLOC_SG, num ? iov[0].iov_base : NULL, total, num != 0);
+      if (num) sg_ops++;
+    }
     else if (op < 80 && alloc_count < MAX_ALLOCS) {  // 5% chance of permalloc
       // Permanent allocation (can't be freed)
       size_t size = (rand() % 512) + 1; // Smaller size for permalloc
@@ -309,6 +849,10 @@ main()
   printf("- realloc: %d\n", realloc_ops);
   printf("- permalloc: %d\n", permalloc_ops);
   printf("- free: %d\n", free_ops);
+  printf("- memalign: %d\n", memalign_ops);
+  printf("- malloc_hint: %d\n", hint_ops);
+  printf("- malloc_sg: %d\n", sg_ops);
+  printf("- try_expand: %d\n", expand_ops);
   printf("Remaining allocations: %d\n", alloc_count);
 
 #ifdef ESTALLOC_DEBUG
@@ -330,6 +874,15 @@ main()
   printf("- Free memory: %u bytes\n", est->stat.free);
   printf("- Fragmentation count: %d\n", est->stat.frag);
 
+  ESTALLOC_FREE_STAT fstat;
+  est_take_free_statistics(est, &fstat);
+  printf("- Largest free block: %u bytes\n", fstat.largest);
+  printf("- Free blocks: %u\n", fstat.count);
+  if (fstat.largest > est->stat.free || (fstat.count == 0) != (est->stat.free == 0)) {
+    printf("FATAL: est_take_free_statistics disagrees with est_take_statistics\n");
+    return 1;
+  }
+
   // Stop profiling
   est_stop_profiling(est);
   printf("\nMemory Usage Profile:\n");
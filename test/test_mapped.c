@@ -0,0 +1,186 @@
+/*! @file
+  @brief
+  Test program for mmap()-backed memory pool of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "../estalloc_mapped.h"
+
+#define POOL_SIZE (256 * 1024 * 1024)   // 256MB pool
+#define CHUNK_SIZE (1024 * 1024)
+#define MAX_CHUNKS (POOL_SIZE / CHUNK_SIZE)
+
+static int fail_hugetlb;        // make mmap(MAP_HUGETLB) fail.
+static int hugetlb_tries;       // mmap(MAP_HUGETLB) calls.
+static int last_mmap_flags;
+
+// Wrap mmap() of estalloc_mapped.c to see its flags and to fail MAP_HUGETLB
+void *
+mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+  last_mmap_flags = flags;
+  if (flags & MAP_HUGETLB) {
+    hugetlb_tries++;
+    if (fail_hugetlb) {
+      errno = ENOMEM;
+      return MAP_FAILED;
+    }
+  }
+  return (void *)syscall(SYS_mmap, addr, length, prot, flags, fd, offset);
+}
+
+// Check that every page of the mapped region is resident
+static int
+check_resident(const char *name, ESTALLOC *est)
+{
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  uint8_t *top = (uint8_t *)est - 2 * sizeof(size_t);   // MAPPED_HEADER
+  size_t length = *(size_t *)top;
+  size_t pages = length / page_size;
+  static unsigned char vec[POOL_SIZE / 4096 + 1024];
+
+  if (pages > sizeof(vec) || mincore(top, length, vec) != 0) {
+    printf("FATAL: mincore(%s) failed\n", name);
+    return 1;
+  }
+  for (size_t i = 0; i < pages; i++) {
+    if (!(vec[i] & 1)) {
+      printf("FATAL: %s: page %zu is not pre-faulted\n", name, i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Allocate the whole pool, read and write every page, and free them
+static int
+check_round_trip(const char *name, ESTALLOC *est, int *n_chunks)
+{
+  static uint8_t *chunk[MAX_CHUNKS];
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  int n = 0;
+
+  while (n < MAX_CHUNKS && (chunk[n] = est_malloc(est, CHUNK_SIZE)) != NULL) {
+    for (size_t i = 0; i < CHUNK_SIZE; i += page_size) {
+      chunk[n][i] = (uint8_t)(n + i / page_size);
+    }
+    chunk[n][CHUNK_SIZE - 1] = (uint8_t)~n;
+    n++;
+  }
+  if (n == 0 || (*n_chunks != 0 && n != *n_chunks)) {
+    printf("FATAL: %s: %d chunks are allocated (expected %d)\n", name, n, *n_chunks);
+    return 1;
+  }
+  *n_chunks = n;
+
+  for (int j = 0; j < n; j++) {
+    for (size_t i = 0; i < CHUNK_SIZE; i += page_size) {
+      if (chunk[j][i] != (uint8_t)(j + i / page_size)) {
+        printf("FATAL: %s: chunk %d is broken at %zu\n", name, j, i);
+        return 1;
+      }
+    }
+    if (chunk[j][CHUNK_SIZE - 1] != (uint8_t)~j) {
+      printf("FATAL: %s: chunk %d is broken at the end\n", name, j);
+      return 1;
+    }
+  }
+  for (int j = 0; j < n; j++) {
+    est_free(est, chunk[j]);
+  }
+  return 0;
+}
+
+// Create a pool, check it, and destroy it
+static int
+run(const char *name, unsigned int flags)
+{
+  struct timespec t0, t1, t2;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  ESTALLOC *est = est_create_mapped(POOL_SIZE, flags);
+  if (est == NULL) {
+    printf("FATAL: est_create_mapped(%s) failed\n", name);
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  // first pass over the memory.
+  for (int i = 0; i < 64; i++) {
+    void *ptr = est_malloc(est, CHUNK_SIZE);
+    if (ptr == NULL) {
+      printf("FATAL: est_malloc(%s) failed\n", name);
+      return 1;
+    }
+    memset(ptr, i, CHUNK_SIZE);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t2);
+
+  printf("%-16s create: %8.3f ms  first 64MB: %8.3f ms\n", name,
+         (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6,
+         (t2.tv_sec - t1.tv_sec) * 1e3 + (t2.tv_nsec - t1.tv_nsec) / 1e6);
+  est_destroy_mapped(est);
+
+  // on a fresh pool, check it twice to see the memory comes back.
+  est = est_create_mapped(POOL_SIZE, flags);
+  if (est == NULL) {
+    printf("FATAL: est_create_mapped(%s) failed\n", name);
+    return 1;
+  }
+  int failed = 0;
+  int n_chunks = 0;
+  if (flags & EST_MAP_PREFAULT) failed |= check_resident(name, est);
+  failed |= check_round_trip(name, est, &n_chunks);
+  failed |= check_round_trip(name, est, &n_chunks);
+
+  est_destroy_mapped(est);
+  return failed;
+}
+
+// Check that EST_MAP_HUGETLB falls back to normal pages with THP
+static int
+test_hugetlb_fallback(void)
+{
+  fail_hugetlb = 1;
+  hugetlb_tries = 0;
+  int failed = run("hugetlb fallback", EST_MAP_HUGETLB | EST_MAP_PREFAULT);
+  fail_hugetlb = 0;
+
+  if (hugetlb_tries != 2 || (last_mmap_flags & MAP_HUGETLB)) {
+    printf("FATAL: MAP_HUGETLB is tried %d times, last flags %#x\n",
+           hugetlb_tries, last_mmap_flags);
+    return 1;
+  }
+  return failed;
+}
+
+int
+main()
+{
+  int failed = 0;
+  failed |= run("plain", 0);
+  failed |= run("thp", EST_MAP_THP);
+  failed |= run("hugetlb", EST_MAP_HUGETLB);
+  failed |= run("prefault", EST_MAP_PREFAULT);
+  failed |= run("prefault x4", EST_MAP_THP | EST_MAP_PREFAULT_THREADS(4));
+  failed |= test_hugetlb_fallback();
+
+  printf("Test %s.\n", failed ? "failed" : "completed");
+  return failed;
+}
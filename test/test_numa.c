@@ -0,0 +1,86 @@
+/*! @file
+  @brief
+  Test program for NUMA-aware front end of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../estalloc_numa.h"
+
+#define POOL_SIZE (4 * 1024 * 1024)   // 4MB pool per node
+#define NUM_THREADS 4
+#define NUM_ALLOCS 1000
+
+static ESTALLOC_NUMA *numa;
+
+// Allocate, fill, verify and free from a worker thread
+static void *
+worker(void *arg)
+{
+  void *ptrs[NUM_ALLOCS];
+  int id = (int)(intptr_t)arg;
+
+  for (int round = 0; round < 10; round++) {
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+      unsigned int size = (rand() % 256) + 1;
+      ptrs[i] = est_numa_malloc(numa, size);
+      if (ptrs[i] == NULL || est_numa_node_of(numa, ptrs[i]) < 0) {
+        printf("FATAL: thread %d: est_numa_malloc failed\n", id);
+        return (void *)1;
+      }
+      memset(ptrs[i], id, size);
+    }
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+      if (*(unsigned char *)ptrs[i] != id) {
+        printf("FATAL: thread %d: memory was overwritten\n", id);
+        return (void *)1;
+      }
+      est_numa_free(numa, ptrs[i]);
+    }
+  }
+  return NULL;
+}
+
+int
+main()
+{
+  numa = est_numa_create(POOL_SIZE);
+  if (numa == NULL) {
+    printf("FATAL: est_numa_create failed\n");
+    return 1;
+  }
+  printf("NUMA nodes: %u\n", est_numa_num_nodes(numa));
+
+  // allocation on the specified node.
+  void *ptr = est_numa_malloc_node(numa, 0, 100);
+  printf("est_numa_malloc_node(0): %p node=%d\n", ptr, est_numa_node_of(numa, ptr));
+  if (ptr == NULL || (est_numa_pool(numa, 0) && est_numa_node_of(numa, ptr) != 0)) {
+    printf("FATAL: est_numa_malloc_node failed\n");
+    return 1;
+  }
+  est_numa_free(numa, ptr);
+
+  pthread_t threads[NUM_THREADS];
+  for (int i = 0; i < NUM_THREADS; i++) {
+    pthread_create(&threads[i], NULL, worker, (void *)(intptr_t)(i + 1));
+  }
+  int failed = 0;
+  for (int i = 0; i < NUM_THREADS; i++) {
+    void *ret;
+    pthread_join(threads[i], &ret);
+    if (ret != NULL) failed = 1;
+  }
+
+  est_numa_destroy(numa);
+  printf("Test %s.\n", failed ? "failed" : "completed");
+  return failed;
+}
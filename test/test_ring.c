@@ -0,0 +1,148 @@
+/*! @file
+  @brief
+  Test program for FIFO ring buffer sub-allocator of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../estalloc_ring.h"
+
+#define POOL_SIZE (64 * 1024)
+#define NUM_MESSAGES 1000000
+
+static uint64_t pool_memory[POOL_SIZE / sizeof(uint64_t)];
+static ESTALLOC_RING *spsc;
+
+// message of 4..200 bytes, filled with its sequence number.
+static unsigned int
+message_size(uint32_t seq)
+{
+  return 4 + (seq * 2654435761u >> 24) % 197;
+}
+
+static int
+check_message(const uint8_t *msg, unsigned int size, uint32_t seq)
+{
+  if (size != message_size(seq)) return 0;
+  if (memcmp(msg, &seq, sizeof(seq)) != 0) return 0;
+  for (unsigned int i = sizeof(seq); i < size; i++) {
+    if (msg[i] != (uint8_t)seq) return 0;
+  }
+  return 1;
+}
+
+static void
+write_message(uint8_t *msg, uint32_t seq)
+{
+  memset(msg, (uint8_t)seq, message_size(seq));
+  memcpy(msg, &seq, sizeof(seq));
+}
+
+// Send messages in order, waiting while the ring is full
+static void *
+producer(void *arg)
+{
+  (void)arg;
+  for (uint32_t seq = 0; seq < NUM_MESSAGES; seq++) {
+    uint8_t *msg;
+    while ((msg = est_ring_reserve(spsc, message_size(seq))) == NULL) {
+      sched_yield();
+    }
+    write_message(msg, seq);
+    est_ring_commit(spsc, message_size(seq));
+  }
+  return NULL;
+}
+
+// Check the order and contents of the messages
+static void *
+consumer(void *arg)
+{
+  (void)arg;
+  for (uint32_t seq = 0; seq < NUM_MESSAGES; seq++) {
+    uint8_t *msg;
+    unsigned int size;
+    while ((msg = est_ring_peek(spsc, &size)) == NULL) {
+      sched_yield();
+    }
+    if (!check_message(msg, size, seq)) {
+      printf("FATAL: message %u is broken\n", seq);
+      return (void *)1;
+    }
+    est_ring_release(spsc);
+  }
+  return NULL;
+}
+
+int
+main()
+{
+  ESTALLOC *est = est_init(pool_memory, POOL_SIZE);
+
+  // single thread. fill, drain and wrap around.
+  ESTALLOC_RING *ring = est_ring_create(est, 256, 0);
+  if (ring == NULL || est_ring_peek(ring, NULL) != NULL) {
+    printf("FATAL: est_ring_create failed\n");
+    return 1;
+  }
+  uint32_t sent = 0, received = 0;
+  for (int round = 0; round < 100; round++) {
+    uint8_t *msg;
+    unsigned int size;
+    int empty = (sent == received);
+    while ((msg = est_ring_reserve(ring, message_size(sent))) != NULL) {
+      write_message(msg, sent);
+      est_ring_commit(ring, message_size(sent));
+      sent++;
+    }
+    if (empty && sent == received) {
+      printf("FATAL: est_ring_reserve failed on an empty ring\n");
+      return 1;
+    }
+    for (int i = round % 3; i >= 0 && (msg = est_ring_peek(ring, &size)) != NULL; i--) {
+      if (!check_message(msg, size, received)) {
+        printf("FATAL: message %u is broken\n", received);
+        return 1;
+      }
+      est_ring_release(ring);
+      received++;
+    }
+  }
+  printf("single thread: %u messages sent, %u received\n", sent, received);
+
+  // commit with a smaller size.
+  while (est_ring_peek(ring, NULL)) est_ring_release(ring);
+  uint8_t *msg = est_ring_reserve(ring, 100);
+  est_ring_commit(ring, 10);
+  unsigned int size;
+  if (msg == NULL || est_ring_peek(ring, &size) != msg || size != 10) {
+    printf("FATAL: est_ring_commit with a smaller size failed\n");
+    return 1;
+  }
+  est_ring_destroy(est, ring);
+
+  // one producer thread and one consumer thread.
+  spsc = est_ring_create(est, 4096, EST_RING_SPSC);
+  pthread_t threads[2];
+  pthread_create(&threads[0], NULL, producer, NULL);
+  pthread_create(&threads[1], NULL, consumer, NULL);
+  void *ret0, *ret1;
+  pthread_join(threads[0], &ret0);
+  pthread_join(threads[1], &ret1);
+  est_ring_destroy(est, spsc);
+  if (ret0 != NULL || ret1 != NULL) return 1;
+  printf("SPSC: %u messages\n", NUM_MESSAGES);
+
+  printf("Test completed.\n");
+  return 0;
+}
@@ -0,0 +1,169 @@
+/*! @file
+  @brief
+  Test program for process-shared memory pool of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../estalloc_shm.h"
+
+#define POOL_SIZE (1024 * 1024)   // 1MB pool
+#define NUM_PROCESSES 4
+#define NUM_ALLOCS 100
+
+static char name[64];
+
+// Allocate, fill, verify and free in a child process, and answer the parent
+static int
+worker(int id, unsigned int message)
+{
+  ESTALLOC_SHM *shm = est_shm_open(name);
+  if (shm == NULL) {
+    printf("FATAL: process %d: est_shm_open failed\n", id);
+    return 1;
+  }
+
+  void *ptrs[NUM_ALLOCS];
+  for (int round = 0; round < 100; round++) {
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+      unsigned int size = (rand() % 256) + 1;
+      ptrs[i] = est_shm_malloc(shm, size);
+      if (ptrs[i] == NULL) {
+        printf("FATAL: process %d: est_shm_malloc failed\n", id);
+        return 1;
+      }
+      memset(ptrs[i], id, size);
+    }
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+      if (*(unsigned char *)ptrs[i] != id) {
+        printf("FATAL: process %d: memory was overwritten\n", id);
+        return 1;
+      }
+      est_shm_free(shm, ptrs[i]);
+    }
+  }
+
+  // the message from the parent, at another address.
+  unsigned char *msg = est_off_to_ptr(est_shm_pool(shm), message);
+  if (strcmp((char *)msg, "hello") != 0) {
+    printf("FATAL: process %d: the message was not handed off\n", id);
+    return 1;
+  }
+  msg[5 + id] = 'a' + id;
+
+  est_shm_close(shm);
+  return 0;
+}
+
+int
+main()
+{
+  snprintf(name, sizeof(name), "/estalloc_test_%d", (int)getpid());
+  ESTALLOC_SHM *shm = est_shm_create(name, POOL_SIZE);
+  if (shm == NULL) {
+    printf("FATAL: est_shm_create failed\n");
+    return 1;
+  }
+
+  // the same pool mapped twice, at different addresses.
+  ESTALLOC_SHM *shm2 = est_shm_open(name);
+  if (shm2 == NULL || shm2 == shm) {
+    printf("FATAL: est_shm_open failed\n");
+    return 1;
+  }
+  char *msg = est_shm_malloc(shm, 64);
+  unsigned int message = est_ptr_to_off(est_shm_pool(shm), msg);
+  memset(msg, 0, 64);
+  strcpy(msg, "hello");
+  char *msg2 = est_off_to_ptr(est_shm_pool(shm2), message);
+  printf("message: offset %u, %p and %p\n", message, msg, msg2);
+  if (msg2 == msg || strcmp(msg2, "hello") != 0) {
+    printf("FATAL: est_off_to_ptr failed\n");
+    return 1;
+  }
+  void *tmp = est_shm_malloc(shm2, 100);
+  est_shm_free(shm, est_off_to_ptr(est_shm_pool(shm), est_ptr_to_off(est_shm_pool(shm2), tmp)));
+  est_shm_close(shm2);
+
+  pid_t pids[NUM_PROCESSES];
+  for (int i = 0; i < NUM_PROCESSES; i++) {
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      srand(i + 1);
+      _exit(worker(i + 1, message));
+    }
+  }
+  int failed = 0;
+  for (int i = 0; i < NUM_PROCESSES; i++) {
+    int status;
+    waitpid(pids[i], &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = 1;
+  }
+
+  for (int i = 1; i <= NUM_PROCESSES; i++) {
+    if (msg[5 + i] != 'a' + i) {
+      printf("FATAL: no answer from process %d\n", i);
+      failed = 1;
+    }
+  }
+  est_shm_free(shm, msg);
+
+  // a process dies holding the lock. the next one takes it over.
+  unsigned int recovered = est_shm_recovered(shm);
+  pid_t pid = fork();
+  if (pid == 0) {
+    ESTALLOC_SHM *child = est_shm_open(name);
+    if (child == NULL || est_shm_lock(child) != 0) _exit(1);
+    _exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  void *tmp2 = est_shm_malloc(shm, 100);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || tmp2 == NULL ||
+      est_shm_recovered(shm) != recovered + 1) {
+    printf("FATAL: the lock was not recovered from a dead process\n");
+    failed = 1;
+  }
+  est_shm_free(shm, tmp2);
+  printf("recovered: %u\n", est_shm_recovered(shm));
+#if defined(ESTALLOC_DEBUG)
+  if (est_sanity_check(est_shm_pool(shm)) != 0) {
+    printf("FATAL: the shared pool is broken\n");
+    failed = 1;
+  }
+#endif
+
+  // a process dies in the middle of breaking the pool. nobody uses it any more.
+  void *target = est_shm_malloc(shm, 100);
+  unsigned int offset = est_ptr_to_off(est_shm_pool(shm), target);
+  pid = fork();
+  if (pid == 0) {
+    ESTALLOC_SHM *child = est_shm_open(name);
+    if (child == NULL || est_shm_lock(child) != 0) _exit(1);
+    // the block size. (USED_BLOCK is 8 bytes with ESTALLOC_ADDRESS_24BIT on 64bit)
+    memset((char *)est_off_to_ptr(est_shm_pool(child), offset) - 8, 0xff, 4);
+    _exit(0);
+  }
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+      est_shm_malloc(shm, 100) != NULL || est_shm_lock(shm) == 0 ||
+      est_shm_recovered(shm) != recovered + 1) {
+    printf("FATAL: the broken pool was taken over\n");
+    failed = 1;
+  }
+
+  est_shm_close(shm);
+  est_shm_unlink(name);
+  printf("Test %s.\n", failed ? "failed" : "completed");
+  return failed;
+}
@@ -0,0 +1,144 @@
+/*! @file
+  @brief
+  Test program for hierarchical sub-pools of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../estalloc_subpool.h"
+
+#define POOL_SIZE (1024 * 1024)   // 1MB pool
+#define SUBPOOL_SIZE (8 * 1024)
+#define NUM_SUBPOOLS 64
+#define NUM_ROUNDS 100
+
+static uint64_t pool_memory[POOL_SIZE / sizeof(uint64_t)];
+
+int
+main()
+{
+  ESTALLOC *est = est_init(pool_memory, POOL_SIZE);
+
+  // create and destroy many sub-pools, leaving blocks in them.
+  ESTALLOC_SUBPOOL *subs[NUM_SUBPOOLS];
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    for (int i = 0; i < NUM_SUBPOOLS; i++) {
+      subs[i] = est_subpool_create(est, SUBPOOL_SIZE);
+      if (subs[i] == NULL) {
+        printf("FATAL: est_subpool_create failed\n");
+        return 1;
+      }
+      for (int j = 0; j < 20; j++) {
+        void *ptr = est_subpool_malloc(subs[i], 16 + (round + i + j) % 200);
+        if (ptr == NULL || !est_subpool_contains(subs[i], ptr)) {
+          printf("FATAL: est_subpool_malloc failed\n");
+          return 1;
+        }
+        if (j % 3 == 0) est_subpool_free(subs[i], ptr);
+      }
+    }
+    for (int i = 0; i < NUM_SUBPOOLS; i++) {
+      est_subpool_destroy(subs[(i * 7) % NUM_SUBPOOLS]);
+    }
+  }
+  printf("%d sub-pools created and destroyed\n", NUM_SUBPOOLS * NUM_ROUNDS);
+
+  // too small for a memory pool.
+  if (est_subpool_create(est, est_min_pool_size() / 2) != NULL ||
+      est_subpool_create(est, 200) != NULL) {
+    printf("FATAL: est_subpool_create accepted a too small size\n");
+    return 1;
+  }
+  ESTALLOC_SUBPOOL *tiny = est_subpool_create(est, est_min_pool_size() + 256);
+  if (tiny == NULL) {
+    printf("FATAL: est_subpool_create failed with the minimum size\n");
+    return 1;
+  }
+
+  // grow by small chunks. rounded up to fit the request.
+  est_subpool_set_grow(tiny, 256);
+  for (int i = 0; i < 32; i++) {
+    void *ptr = est_subpool_malloc(tiny, 100 + i * 16);
+    if (ptr == NULL || !est_subpool_contains(tiny, ptr)) {
+      printf("FATAL: the sub-pool did not grow by small chunks\n");
+      return 1;
+    }
+    memset(ptr, i, 100 + i * 16);
+  }
+  est_subpool_destroy(tiny);
+
+  // isolation. a full sub-pool does not take the memory of the parent.
+  ESTALLOC_SUBPOOL *sub = est_subpool_create(est, SUBPOOL_SIZE);
+  ESTALLOC_SUBPOOL *other = est_subpool_create(est, SUBPOOL_SIZE);
+  int count = 0;
+  while (est_subpool_malloc(sub, 256) != NULL) count++;
+  if (count == 0 || count * 256 >= SUBPOOL_SIZE) {
+    printf("FATAL: the sub-pool was not limited to its size\n");
+    return 1;
+  }
+  void *ptr = est_subpool_malloc(other, 100);
+  est_subpool_free(sub, ptr);     // ignored
+  if (est_subpool_contains(sub, ptr) || !est_subpool_contains(other, ptr)) {
+    printf("FATAL: est_subpool_contains failed\n");
+    return 1;
+  }
+  printf("isolation: %d blocks in a full sub-pool\n", count);
+
+  // grow by chunks of the parent.
+  est_subpool_set_grow(sub, SUBPOOL_SIZE);
+  void *grown[64];
+  for (int i = 0; i < 64; i++) {
+    grown[i] = est_subpool_malloc(sub, 256);
+    if (grown[i] == NULL || !est_subpool_contains(sub, grown[i])) {
+      printf("FATAL: the sub-pool did not grow\n");
+      return 1;
+    }
+    memset(grown[i], i, 256);
+  }
+  void *large = est_subpool_malloc(sub, SUBPOOL_SIZE * 2);
+  if (large == NULL) {
+    printf("FATAL: the sub-pool did not grow for a large block\n");
+    return 1;
+  }
+  uint8_t *moved = est_subpool_realloc(sub, grown[0], 4096);
+  if (moved == NULL || moved[255] != 0 || !est_subpool_contains(sub, moved)) {
+    printf("FATAL: est_subpool_realloc failed\n");
+    return 1;
+  }
+
+  // nested sub-pool in a sub-pool.
+  ESTALLOC_SUBPOOL *child = est_subpool_create(est_subpool_pool(other), 2048);
+  if (child == NULL || !est_subpool_contains(other, child) ||
+      est_subpool_malloc(child, 4096) != NULL) {
+    printf("FATAL: nested sub-pool failed\n");
+    return 1;
+  }
+  est_subpool_destroy(child);
+  est_subpool_destroy(other);
+  est_subpool_destroy(sub);
+
+  // everything is back in the parent.
+  void *all = est_malloc(est, POOL_SIZE - 4096);
+  if (all == NULL) {
+    printf("FATAL: memory was not returned to the parent\n");
+    return 1;
+  }
+  est_free(est, all);
+#if defined(ESTALLOC_DEBUG)
+  if (est_sanity_check(est) != 0) {
+    printf("FATAL: the parent pool is broken\n");
+    return 1;
+  }
+#endif
+
+  printf("Test completed.\n");
+  return 0;
+}
@@ -0,0 +1,86 @@
+/*! @file
+  @brief
+  Test program for memory tier front end of ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../estalloc_tier.h"
+
+#define FAST_SIZE (16 * 1024)         // internal SRAM
+#define SLOW_SIZE (256 * 1024)        // PSRAM
+
+static uint64_t fast_memory[FAST_SIZE / sizeof(uint64_t)];
+static uint64_t slow_memory[SLOW_SIZE / sizeof(uint64_t)];
+
+int
+main()
+{
+  ESTALLOC_TIER tier;
+  est_tier_init(&tier);
+  if (est_tier_add(&tier, fast_memory, FAST_SIZE) != 0 ||
+      est_tier_add(&tier, slow_memory, SLOW_SIZE) != 1) {
+    printf("FATAL: est_tier_add failed\n");
+    return 1;
+  }
+
+  // allocation on the preferred tier.
+  void *hot = est_malloc_tier(&tier, 100, 0, EST_TIER_NO_FALLBACK);
+  void *cold = est_malloc_tier(&tier, 100, 1, EST_TIER_NO_FALLBACK);
+  printf("hot: %p tier=%d  cold: %p tier=%d\n", hot, est_tier_of(&tier, hot),
+         cold, est_tier_of(&tier, cold));
+  if (est_tier_of(&tier, hot) != 0 || est_tier_of(&tier, cold) != 1) {
+    printf("FATAL: est_malloc_tier allocated on a wrong tier\n");
+    return 1;
+  }
+
+  // fill the fast tier, then fall back to the slow one.
+  int spilled = 0;
+  for (int i = 0; i < 64; i++) {
+    void *ptr = est_malloc_tier(&tier, 1024, 0, EST_TIER_FALLBACK);
+    if (ptr == NULL) {
+      printf("FATAL: est_malloc_tier with fallback failed\n");
+      return 1;
+    }
+    if (est_tier_of(&tier, ptr) == 1) spilled++;
+  }
+  if (spilled == 0 || est_malloc_tier(&tier, 1024, 0, EST_TIER_NO_FALLBACK) != NULL) {
+    printf("FATAL: the fast tier was not exhausted\n");
+    return 1;
+  }
+  printf("spilled to the slow tier: %d\n", spilled);
+
+  // migrate keeps the contents.
+  memset(cold, 0x5a, 100);
+  est_tier_free(&tier, hot);
+  void *moved = est_tier_migrate(&tier, cold, 0);
+  if (moved == NULL || est_tier_of(&tier, moved) != 0) {
+    printf("FATAL: est_tier_migrate failed\n");
+    return 1;
+  }
+  for (int i = 0; i < 100; i++) {
+    if (((uint8_t *)moved)[i] != 0x5a) {
+      printf("FATAL: est_tier_migrate lost the contents\n");
+      return 1;
+    }
+  }
+
+  // realloc moves to another tier when the owning one is full.
+  void *grown = est_tier_realloc(&tier, moved, 8 * 1024);
+  if (grown == NULL || est_tier_of(&tier, grown) != 1 || ((uint8_t *)grown)[99] != 0x5a) {
+    printf("FATAL: est_tier_realloc failed\n");
+    return 1;
+  }
+  est_tier_free(&tier, grown);
+
+  printf("Test completed.\n");
+  return 0;
+}
@@ -0,0 +1,226 @@
+/*! @file
+  @brief
+  Profile-guided size class table generator for ESTALLOC.
+
+  <pre>
+  Original Copyright:
+    (C) 2025- HASUMI Hitoshi @hasumikin
+
+  This file is distributed under BSD 3-Clause License.
+
+  USAGE
+    $ tools/est_sizeclass [options] histogram.txt > est_size_class.h
+    $ cc -DESTALLOC_SIZE_CLASS_HEADER='"est_size_class.h"' ... estalloc.c
+
+    histogram.txt: one "<request size> [<count>]" per line.
+                   An allocation trace with one size per line also works.
+                   Lines beginning with '#' are ignored.
+
+    options:
+      -a <n>  ESTALLOC_ALIGNMENT (default: 8)
+      -h <n>  sizeof(USED_BLOCK) (default: 8)
+      -m <n>  ESTALLOC_MIN_MEMORY_BLOCK_SIZE (default: 32)
+      -i <n>  ESTALLOC_IGNORE_LSBS (default: 5)
+      -s <n>  ESTALLOC_SLI_BIT_WIDTH (default: 3)
+      -l <n>  limit of the table. larger blocks use the default TLSF index.
+              (default: 4096)
+      -b <n>  number of bins in the table. (default: as many as possible)
+
+  STRATEGY
+   Request sizes are converted to block sizes as est_malloc() does.
+   The hottest block sizes get exact bins [size, size + alignment),
+   and the remaining ranges are split where the ratio of the bounds is
+   largest, until the bin budget is used up. The budget is limited to
+   the default index of the limit, so that the default TLSF index
+   shifted down covers blocks larger than the limit.
+  </pre>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_LIMIT 65536
+#define MAX_BINS  256
+
+static unsigned int alignment = 8;
+static unsigned int header_size = 8;
+static unsigned int min_block_size = 32;
+static unsigned int ignore_lsbs = 5;
+static unsigned int sli_bit_width = 3;
+static unsigned int limit = 4096;
+
+static unsigned long long histogram[MAX_LIMIT];
+
+
+// Default index of ESTALLOC. Same as calc_index() in estalloc.c
+static unsigned int
+default_index(unsigned int size)
+{
+  unsigned int x = size >> (sli_bit_width + ignore_lsbs);
+  unsigned int fli = 0;
+  while (x) {
+    fli++;
+    x >>= 1;
+  }
+  unsigned int shift = (fli == 0) ? ignore_lsbs : (ignore_lsbs - 1 + fli);
+  unsigned int sli = (size >> shift) & ((1 << sli_bit_width) - 1);
+  return (fli << sli_bit_width) + sli;
+}
+
+// Block size for the request size. Same as est_malloc() in estalloc.c
+static unsigned int
+block_size(unsigned int size)
+{
+  unsigned int alloc_size = size + header_size;
+  alloc_size += (-alloc_size & (alignment - 1));
+  if (alloc_size < min_block_size) alloc_size = min_block_size;
+  return alloc_size;
+}
+
+static int
+compare_uint(const void *a, const void *b)
+{
+  unsigned int x = *(const unsigned int *)a;
+  unsigned int y = *(const unsigned int *)b;
+  return (x > y) - (x < y);
+}
+
+static int
+has_bound(unsigned int *bounds, int n, unsigned int value)
+{
+  for (int i = 0; i < n; i++) {
+    if (bounds[i] == value) return 1;
+  }
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int bins = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "a:h:m:i:s:l:b:")) != -1) {
+    unsigned int value = (unsigned int)strtoul(optarg, NULL, 0);
+    switch (opt) {
+    case 'a': alignment = value; break;
+    case 'h': header_size = value; break;
+    case 'm': min_block_size = value; break;
+    case 'i': ignore_lsbs = value; break;
+    case 's': sli_bit_width = value; break;
+    case 'l': limit = value; break;
+    case 'b': bins = (int)value; break;
+    default:
+      fprintf(stderr, "usage: %s [-a align] [-h header] [-m min_block] [-i ignore_lsbs] [-s sli_bits] [-l limit] [-b bins] histogram.txt\n", argv[0]);
+      return 1;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "%s: no input file\n", argv[0]);
+    return 1;
+  }
+  if (limit > MAX_LIMIT || limit % alignment != 0 || limit <= min_block_size) {
+    fprintf(stderr, "%s: invalid limit %u\n", argv[0], limit);
+    return 1;
+  }
+
+  // bins must not exceed the default index of the limit.
+  int max_bins = (int)default_index(limit);
+  if (max_bins > MAX_BINS) max_bins = MAX_BINS;
+  if (bins == 0 || bins > max_bins) bins = max_bins;
+
+  // read histogram.
+  FILE *fp = fopen(argv[optind], "r");
+  if (fp == NULL) {
+    perror(argv[optind]);
+    return 1;
+  }
+  char line[256];
+  unsigned long long total = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    unsigned int size;
+    unsigned long long count = 1;
+    if (line[0] == '#') continue;
+    int n = sscanf(line, "%u %llu", &size, &count);
+    if (n < 1) continue;
+    unsigned int bsize = block_size(size);
+    if (bsize < limit) {
+      histogram[bsize] += count;
+      total += count;
+    }
+  }
+  fclose(fp);
+
+  // bounds: 0, limit, and the exact bins of the hottest sizes.
+  unsigned int bounds[MAX_BINS + 2];
+  int num_bounds = 0;
+  bounds[num_bounds++] = 0;
+  bounds[num_bounds++] = limit;
+
+  while (num_bounds - 1 < bins) {
+    unsigned int hot = 0;
+    for (unsigned int s = min_block_size; s < limit; s += alignment) {
+      if (histogram[s] > histogram[hot]) hot = s;
+    }
+    if (hot == 0) break;
+    int need = !has_bound(bounds, num_bounds, hot) + !has_bound(bounds, num_bounds, hot + alignment);
+    if (num_bounds - 1 + need > bins) break;
+    if (!has_bound(bounds, num_bounds, hot)) bounds[num_bounds++] = hot;
+    if (!has_bound(bounds, num_bounds, hot + alignment)) bounds[num_bounds++] = hot + alignment;
+    fprintf(stderr, "exact bin: %5u bytes (%llu times, %.1f%%)\n",
+            hot, histogram[hot], total ? histogram[hot] * 100.0 / total : 0.0);
+    histogram[hot] = 0;
+  }
+  qsort(bounds, num_bounds, sizeof(bounds[0]), compare_uint);
+
+  // split the range which has the largest ratio of bounds.
+  while (num_bounds - 1 < bins) {
+    int widest = -1;
+    double widest_ratio = 1.0;
+    for (int i = 0; i < num_bounds - 1; i++) {
+      unsigned int lo = bounds[i] < min_block_size ? min_block_size : bounds[i];
+      unsigned int hi = bounds[i + 1];
+      if (hi <= lo + alignment) continue;
+      double ratio = (double)hi / lo;
+      if (ratio > widest_ratio) {
+        widest_ratio = ratio;
+        widest = i;
+      }
+    }
+    if (widest < 0) break;
+    unsigned int lo = bounds[widest] < min_block_size ? min_block_size : bounds[widest];
+    unsigned int mid = lo + (bounds[widest + 1] - lo) / 2;
+    mid += (-mid & (alignment - 1));
+    bounds[num_bounds++] = mid;
+    qsort(bounds, num_bounds, sizeof(bounds[0]), compare_uint);
+  }
+
+  // output header.
+  printf("/*! @file\n");
+  printf("  @brief\n");
+  printf("  Size class table for ESTALLOC. Generated by tools/est_sizeclass.\n");
+  printf("  Do not edit.\n\n");
+  printf("  input: %s\n", argv[optind]);
+  printf("  bins:");
+  for (int i = 0; i < num_bounds - 1; i++) {
+    printf("%s%u", (i % 12) == 0 ? "\n    " : " ", bounds[i]);
+  }
+  printf("\n*/\n\n");
+  printf("#ifndef ESTALLOC_SIZE_CLASS_H_\n");
+  printf("#define ESTALLOC_SIZE_CLASS_H_\n\n");
+  printf("#define ESTALLOC_SIZE_CLASS_ALIGNMENT %u\n", alignment);
+  printf("#define ESTALLOC_SIZE_CLASS_LIMIT %u\n", limit);
+  printf("#define ESTALLOC_SIZE_CLASS_BINS %d\n\n", num_bounds - 1);
+  printf("static const uint8_t est_size_class_index[%u] = {", limit / alignment);
+  int index = 0;
+  for (unsigned int s = 0; s < limit; s += alignment) {
+    while (index + 1 < num_bounds - 1 && bounds[index + 1] <= s) index++;
+    printf("%s%2d,", (s / alignment % 16) == 0 ? "\n  " : " ", index);
+  }
+  printf("\n};\n\n");
+  printf("#endif\n");
+
+  return 0;
+}